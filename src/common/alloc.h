@@ -0,0 +1,151 @@
+/**
+ * @file alloc.h
+ * @author dromniscience (you@domain.com)
+ * @brief Allocation policies for the storage of sketches
+ *
+ * @details A policy is a class with two static member templates,
+ * - `template <typename T> static T *allocate(size_t n)`, returning `n`
+ * value-initialized objects, and
+ * - `template <typename T> static void deallocate(T *ptr, size_t n)`, which
+ * destroys and releases what `allocate<T>(n)` returned.
+ *
+ * Sketches take a policy as their last template argument (Util::DefaultAlloc
+ * if omitted) and use it for their counter arrays and bucket tables. Small
+ * auxiliary objects, such as hashing classes, are still allocated by `new`.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace OmniSketch::Util {
+/**
+ * @brief Plain `new[]`, i.e., what sketches used to do
+ *
+ */
+struct DefaultAlloc {
+  template <typename T> static T *allocate(size_t n) { return new T[n](); }
+  template <typename T> static void deallocate(T *ptr, size_t) {
+    delete[] ptr;
+  }
+};
+
+/**
+ * @brief Aligned to `Align` bytes, a cache line by default
+ *
+ */
+template <size_t Align = 64> struct AlignedAlloc {
+  template <typename T> static T *allocate(size_t n) {
+    constexpr size_t align = Align > alignof(T) ? Align : alignof(T);
+    T *ptr = static_cast<T *>(
+        ::operator new(sizeof(T) * n, std::align_val_t(align)));
+    std::uninitialized_value_construct_n(ptr, n);
+    return ptr;
+  }
+  template <typename T> static void deallocate(T *ptr, size_t n) {
+    constexpr size_t align = Align > alignof(T) ? Align : alignof(T);
+    if (!ptr)
+      return;
+    std::destroy_n(ptr, n);
+    ::operator delete(ptr, std::align_val_t(align));
+  }
+};
+
+/**
+ * @brief Backed by 2 MB huge pages, optionally bound to a NUMA node
+ *
+ * @details The array is mapped with `MAP_HUGETLB` if huge pages are reserved
+ * (see `/proc/sys/vm/nr_hugepages`). Otherwise it falls back to ordinary pages
+ * with `madvise(MADV_HUGEPAGE)`, so that transparent huge pages back it if
+ * enabled in `madvise` or `always` mode. Either way, a 100 MB sketch then
+ * takes 50 TLB entries instead of 25600, and the array starts at a page
+ * boundary, hence cache aligned.
+ *
+ * If `Node` is non-negative, pages are bound to that NUMA node with `mbind()`
+ * before they are first touched. Run the sketch on a CPU of the same node.
+ *
+ * Sizes are rounded up to 2 MB, so the policy is meant for large arrays only.
+ * On other platforms than Linux, it is the same as AlignedAlloc.
+ *
+ * @tparam Node  NUMA node to bind to, or -1 for the default policy
+ */
+template <int32_t Node = -1> struct HugePageAlloc {
+  static constexpr size_t PAGE = 2UL << 20;
+
+  template <typename T> static T *allocate(size_t n) {
+#if defined(__linux__)
+    const size_t len = length<T>(n);
+    void *ptr = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (ptr == MAP_FAILED) {
+      // no huge page reserved: map 2 MB more and trim both ends, so that the
+      // array starts at a 2 MB boundary as a huge page would
+      void *raw = mmap(nullptr, len + PAGE, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (raw == MAP_FAILED)
+        throw std::bad_alloc();
+      const uintptr_t addr = reinterpret_cast<uintptr_t>(raw);
+      const uintptr_t aligned = (addr + PAGE - 1) / PAGE * PAGE;
+      if (aligned > addr) {
+        munmap(raw, aligned - addr);
+      }
+      munmap(reinterpret_cast<void *>(aligned + len), addr + PAGE - aligned);
+      ptr = reinterpret_cast<void *>(aligned);
+#if defined(MADV_HUGEPAGE)
+      madvise(ptr, len, MADV_HUGEPAGE);
+#endif
+    }
+    if constexpr (Node >= 0) {
+      constexpr int32_t MPOL_BIND_ = 2; // MPOL_BIND in <numaif.h>
+      constexpr size_t bits = 8 * sizeof(unsigned long);
+      unsigned long mask[Node / bits + 1] = {};
+      mask[Node / bits] = 1UL << (Node % bits);
+      // the kernel reads one bit less than `maxnode`
+      if (syscall(SYS_mbind, ptr, len, MPOL_BIND_, mask, Node + 2, 0) != 0) {
+        munmap(ptr, len);
+        throw std::invalid_argument("Invalid Argument: Cannot bind memory to "
+                                    "NUMA node " +
+                                    std::to_string(Node) + ".");
+      }
+    }
+    T *arr = static_cast<T *>(ptr);
+    std::uninitialized_value_construct_n(arr, n);
+    return arr;
+#else
+    return AlignedAlloc<>::allocate<T>(n);
+#endif
+  }
+  template <typename T> static void deallocate(T *ptr, size_t n) {
+#if defined(__linux__)
+    if (!ptr)
+      return;
+    std::destroy_n(ptr, n);
+    munmap(ptr, length<T>(n));
+#else
+    AlignedAlloc<>::deallocate(ptr, n);
+#endif
+  }
+
+private:
+  /**
+   * @brief Length of the mapping, a positive multiple of 2 MB
+   *
+   */
+  template <typename T> static size_t length(size_t n) {
+    return (sizeof(T) * n + PAGE - 1) / PAGE * PAGE + (n ? 0 : PAGE);
+  }
+};
+
+} // namespace OmniSketch::Util
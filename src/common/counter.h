@@ -0,0 +1,245 @@
+/**
+ * @file counter.h
+ * @author dromniscience (you@domain.com)
+ * @brief Table of narrow saturating counters with overflow escalation
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include "table.h"
+#include <limits>
+#include <type_traits>
+
+namespace OmniSketch::Util {
+/**
+ * @brief Row-major table of counters, each stored in a narrow cell
+ *
+ * @details Most counters in a sketch fed with skewed traffic stay small, so a
+ * cell of type `cell_t` (e.g., `uint8_t` or `uint16_t`) is enough for them.
+ * Cell arithmetic saturates: the largest value of `cell_t` is reserved as a
+ * mark that the cell has escalated, and its exact value is then kept as a `T`
+ * in a secondary open-addressing table indexed by the offset of the cell. An
+ * escalated cell never goes back, but only the few cells of the elephant flows
+ * ever get there.
+ *
+ * If `cell_t` is `T`, cells are plain counters and there is no escalation.
+ * Counters should never be negative if `cell_t` is narrower than `T`.
+ *
+ * @tparam T        type of the counter
+ * @tparam cell_t   type of the cell, an unsigned integer no wider than `T`
+ * @tparam Rows     # rows if fixed at compile time; 0 otherwise
+ * @tparam Cols     # columns if fixed at compile time; 0 otherwise
+ * @tparam alloc_t  allocation policy of the cells (see alloc.h)
+ */
+template <typename T, typename cell_t = T, int32_t Rows = 0, int32_t Cols = 0,
+          typename alloc_t = DefaultAlloc>
+class CounterTable {
+public:
+  /**
+   * @brief Whether cells are narrower than counters
+   *
+   */
+  static constexpr bool NARROW = !std::is_same_v<T, cell_t>;
+
+private:
+  static_assert(!NARROW || (std::is_unsigned_v<cell_t> &&
+                            sizeof(cell_t) <= sizeof(T)),
+                "Narrow cells should be unsigned and no wider than counters.");
+  /**
+   * @brief Cell value marking an escalated counter
+   *
+   */
+  static constexpr cell_t SAT = std::numeric_limits<cell_t>::max();
+  /**
+   * @brief Offset marking an empty slot in the escalation table
+   *
+   */
+  static constexpr size_t EMPTY = std::numeric_limits<size_t>::max();
+
+  Table<cell_t, Rows, Cols, alloc_t> cells;
+  /// escalation table: offsets of escalated cells and their exact values
+  size_t *esc_pos;
+  T *esc_val;
+  size_t esc_cap; // 0 or a power of 2
+  size_t esc_num;
+
+  CounterTable(const CounterTable &) = delete;
+  CounterTable(CounterTable &&) = delete;
+  CounterTable &operator=(CounterTable) = delete;
+
+  /**
+   * @brief Slot of an escalated cell, or the empty slot to insert it at
+   *
+   */
+  size_t probe(size_t pos) const {
+    size_t slot = (pos * 0x9E3779B97F4A7C15ULL >> 20) & (esc_cap - 1);
+    while (esc_pos[slot] != pos && esc_pos[slot] != EMPTY)
+      slot = (slot + 1) & (esc_cap - 1);
+    return slot;
+  }
+  /**
+   * @brief Double the escalation table (start with 64 slots)
+   *
+   */
+  void grow() {
+    size_t *old_pos = esc_pos;
+    T *old_val = esc_val;
+    size_t old_cap = esc_cap;
+    esc_cap = old_cap ? old_cap * 2 : 64;
+    esc_pos = new size_t[esc_cap];
+    esc_val = new T[esc_cap];
+    std::fill(esc_pos, esc_pos + esc_cap, EMPTY);
+    for (size_t i = 0; i < old_cap; ++i) {
+      if (old_pos[i] != EMPTY) {
+        size_t slot = probe(old_pos[i]);
+        esc_pos[slot] = old_pos[i];
+        esc_val[slot] = old_val[i];
+      }
+    }
+    delete[] old_pos;
+    delete[] old_val;
+  }
+  /**
+   * @brief Move a counter to the escalation table
+   *
+   */
+  void escalate(size_t pos, T val) {
+    // keep the load factor at most 1/2
+    if (2 * (esc_num + 1) > esc_cap)
+      grow();
+    size_t slot = probe(pos);
+    esc_pos[slot] = pos;
+    esc_val[slot] = val;
+    esc_num++;
+    cells.data()[pos] = SAT;
+  }
+
+public:
+  /**
+   * @brief Construct by specifying the dimensions
+   * @details A dimension fixed at compile time must agree with the argument.
+   */
+  CounterTable(int32_t rows, int32_t cols)
+      : cells(rows, cols), esc_pos(nullptr), esc_val(nullptr), esc_cap(0),
+        esc_num(0) {}
+  /**
+   * @brief Release the escalation table
+   *
+   */
+  ~CounterTable() {
+    delete[] esc_pos;
+    delete[] esc_val;
+  }
+  /**
+   * @brief # rows
+   *
+   */
+  int32_t rows() const { return cells.rows(); }
+  /**
+   * @brief # columns
+   *
+   */
+  int32_t cols() const { return cells.cols(); }
+  /**
+   * @brief # cells
+   *
+   */
+  size_t numCell() const { return cells.numCell(); }
+  /**
+   * @brief Offset of a cell, as used by the other accessors
+   *
+   */
+  size_t offset(int32_t row, int32_t col) const {
+    return static_cast<size_t>(row) * cols() + col;
+  }
+  /**
+   * @brief Pointer to the first cell
+   * @details Cells are exact counters only if `NARROW` is false.
+   */
+  cell_t *data() { return cells.data(); }
+  /**
+   * @brief Value of a counter
+   *
+   */
+  T get(size_t pos) const {
+    const cell_t cell = cells.data()[pos];
+    if constexpr (NARROW) {
+      if (cell == SAT)
+        return esc_val[probe(pos)];
+    }
+    return cell;
+  }
+  /**
+   * @brief Set a counter
+   *
+   */
+  void set(size_t pos, T val) {
+    cell_t &cell = cells.data()[pos];
+    if constexpr (NARROW) {
+      if (cell == SAT) {
+        esc_val[probe(pos)] = val;
+      } else if (val >= static_cast<T>(SAT)) {
+        escalate(pos, val);
+      } else {
+        cell = static_cast<cell_t>(val);
+      }
+    } else {
+      cell = val;
+    }
+  }
+  /**
+   * @brief Add to a counter
+   * @return the counter after addition
+   */
+  T add(size_t pos, T val) {
+    if constexpr (NARROW) {
+      const cell_t cell = cells.data()[pos];
+      // fast path: the sum still fits in the cell
+      if (cell != SAT && val < static_cast<T>(SAT - cell)) {
+        cells.data()[pos] = static_cast<cell_t>(cell + val);
+        return cell + val;
+      }
+      const T sum = get(pos) + val;
+      set(pos, sum);
+      return sum;
+    } else {
+      return cells.data()[pos] += val;
+    }
+  }
+  /**
+   * @brief Raise a counter to at least `val`
+   *
+   */
+  void raise(size_t pos, T val) {
+    if (get(pos) < val)
+      set(pos, val);
+  }
+  /**
+   * @brief # counters in the escalation table
+   *
+   */
+  size_t numEscalated() const { return esc_num; }
+  /**
+   * @brief Size of the cells and the escalation table on the heap (in bytes)
+   * @details Cells stored inside the instance are counted in the size of the
+   * instance (and its owner) instead.
+   */
+  size_t size() const {
+    return cells.size() + esc_cap * (sizeof(size_t) + sizeof(T));
+  }
+  /**
+   * @brief Reset all counters to zero and empty the escalation table
+   *
+   */
+  void clear() {
+    cells.clear();
+    if (esc_num) {
+      std::fill(esc_pos, esc_pos + esc_cap, EMPTY);
+      esc_num = 0;
+    }
+  }
+};
+
+} // namespace OmniSketch::Util
@@ -0,0 +1,150 @@
+/**
+ * @file epoch.h
+ * @author dromniscience (you@domain.com)
+ * @brief Rotate sketches across measurement epochs
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace OmniSketch::Util {
+/**
+ * @brief Rotate sketch instances across measurement epochs, clearing retired
+ * instances on a background thread
+ *
+ * @details Three instances are kept: the active one that ingests the current
+ * epoch, the previous one that holds the results of the last epoch, and a
+ * spare one that is being (or has been) cleared. rotate() turns the spare
+ * into the active one, the active one into the previous one, and hands the
+ * old previous one over to the cleaner thread. As long as clearing a sketch
+ * takes less than an epoch, rotate() never waits and costs O(1) on the ingest
+ * path.
+ *
+ * Only the ingest thread should call the methods. Note that instances do not
+ * share hashing classes, so results of different epochs are comparable only
+ * in flowkeys, not in counters.
+ *
+ * @tparam sketch_t  type of the sketch, which should have `void clear()`
+ */
+template <typename sketch_t> class EpochRotator {
+private:
+  std::unique_ptr<sketch_t> active;
+  std::unique_ptr<sketch_t> previous;
+  std::unique_ptr<sketch_t> spare;   // cleared, or nullptr while clearing
+  std::unique_ptr<sketch_t> retired; // to be cleared
+  uint64_t num_epoch;
+
+  std::mutex mtx;
+  std::condition_variable cv;
+  bool stop;
+  std::thread cleaner;
+
+  EpochRotator(const EpochRotator &) = delete;
+  EpochRotator(EpochRotator &&) = delete;
+  EpochRotator &operator=(EpochRotator) = delete;
+
+  /**
+   * @brief Body of the cleaner thread
+   *
+   */
+  void clean() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+      cv.wait(lock, [this] { return retired || stop; });
+      if (!retired)
+        return;
+      std::unique_ptr<sketch_t> sketch = std::move(retired);
+      lock.unlock();
+      sketch->clear();
+      lock.lock();
+      spare = std::move(sketch);
+      cv.notify_all();
+    }
+  }
+
+public:
+  /**
+   * @brief Construct the instances with the same arguments
+   * @details Pass the arguments of the constructor of `sketch_t`.
+   */
+  template <typename... Args>
+  EpochRotator(const Args &...args)
+      : active(new sketch_t(args...)), previous(new sketch_t(args...)),
+        spare(new sketch_t(args...)), num_epoch(0), stop(false) {
+    cleaner = std::thread(&EpochRotator::clean, this);
+  }
+  /**
+   * @brief Take over three empty instances of identical configuration
+   * @details Useful when `sketch_t` is a base class, e.g.,
+   * Sketch::SketchBase.
+   */
+  EpochRotator(std::unique_ptr<sketch_t> active_,
+               std::unique_ptr<sketch_t> previous_,
+               std::unique_ptr<sketch_t> spare_)
+      : active(std::move(active_)), previous(std::move(previous_)),
+        spare(std::move(spare_)), num_epoch(0), stop(false) {
+    cleaner = std::thread(&EpochRotator::clean, this);
+  }
+  /**
+   * @brief Stop the cleaner thread
+   *
+   */
+  ~EpochRotator() {
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      stop = true;
+    }
+    cv.notify_all();
+    cleaner.join();
+  }
+  /**
+   * @brief Sketch of the current epoch
+   *
+   */
+  sketch_t &current() { return *active; }
+  /**
+   * @brief Sketch of the last epoch
+   * @details Valid until the next rotate(). Empty before the first rotate().
+   */
+  sketch_t &last() { return *previous; }
+  /**
+   * @brief # rotations so far, i.e., the index of the current epoch
+   *
+   */
+  uint64_t epoch() const { return num_epoch; }
+  /**
+   * @brief Start a new epoch
+   * @details Waits only if the cleaner has not finished the instance retired
+   * by the previous rotate().
+   *
+   * @return the sketch of the new epoch
+   */
+  sketch_t &rotate() {
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.wait(lock, [this] { return spare != nullptr; });
+    retired = std::move(previous);
+    previous = std::move(active);
+    active = std::move(spare);
+    num_epoch++;
+    lock.unlock();
+    cv.notify_all();
+    return *active;
+  }
+  /**
+   * @brief Wait until the retired instance is cleared
+   *
+   */
+  void sync() {
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.wait(lock, [this] { return spare != nullptr; });
+  }
+};
+
+} // namespace OmniSketch::Util
@@ -12,11 +12,27 @@
 #include "utils.h"
 #include <Eigen/Dense>
 #include <Eigen/IterativeLinearSolvers>
+#include <Eigen/OrderingMethods>
 #include <Eigen/SparseCore>
+#include <Eigen/SparseQR>
 #include <boost/dynamic_bitset.hpp>
-#include <map>
+#include <chrono>
 
 namespace OmniSketch::Sketch {
+/**
+ * @brief Solvers used by CH to decode a layer
+ *
+ * @details When compiled with OpenMP, products with a row-major sparse matrix
+ * are parallelized by Eigen, and so is the construction of the matrix.
+ */
+enum DecodeSolver {
+  LSCG /** Eigen::LeastSquaresConjugateGradient, only `A * x` is parallel */,
+  CGLS /** CG on the normal equations with both `A * x` and `A^T * y`
+          parallel, at the cost of storing `A^T` */
+  ,
+  QR /** Eigen::SparseQR, a direct method suitable for small layers */,
+};
+
 /**
  * @brief Use the counter hierarchy to better save space while preserving
  * accuracy!
@@ -30,9 +46,10 @@ namespace OmniSketch::Sketch {
  * index of a possibly multi-dimensional array into a unique serial number.
  * Since CH uses 0-based array internally, this serial number is chosen to
  * have type `size_t`.
- * - CH uses **lazy update policy**. That is, only when you try to get a counter
- * value in CH will the updates genuinely be propagated to the higher layers
- * and then decoded.
+ * - CH uses **lazy update policy**. That is, updates are buffered and only when
+ * you try to get a counter value in CH (or the buffer is full) will they
+ * genuinely be propagated to the higher layers. Decoding is deferred until a
+ * counter value is requested.
  * - Note that CH cannot bring better accuracy. Ideally, if the first layer in
  * CH never overflows, your sketch achieves the same accuracy as does without
  * it.
@@ -49,7 +66,7 @@ namespace OmniSketch::Sketch {
 template <int32_t no_layer, typename T, typename hash_t = Hash::AwareHash>
 class CounterHierarchy {
 private:
-  using CarryOver = std::map<std::size_t, T>;
+  using SpMat = Eigen::SparseMatrix<double, Eigen::RowMajor>;
   /**
    * @brief Number of counters on each layer, from low to high.
    *
@@ -72,10 +89,10 @@ private:
    */
   std::vector<hash_t> *hash_fns;
   /**
-   * @brief counters in CH
+   * @brief counters in CH, bit-packed on each layer
    *
    */
-  std::vector<Util::DynamicIntX<T>> *cnt_array;
+  std::vector<Util::PackedIntArray<T>> cnt_array;
   /**
    * @brief Status bits
    *
@@ -83,50 +100,163 @@ private:
   boost::dynamic_bitset<uint8_t> *status_bits;
   /**
    * @brief Original counters
+   * @details A reference copy of the counters without CH, kept only if asked
+   * for on construction. Otherwise it is empty.
    *
    */
   std::vector<T> original_cnt;
   /**
-   * @brief get decoded counter
-   * @details `double` will round to `T` after decoding each layer. The reason
-   * why `double` here is to facilitate NZE decoding.
+   * @brief Sparse carry-in of each layer
+   * @details `carry[0]` buffers the lazy updates and holds at most
+   * `max_pending` counters. On higher layers, it aggregates the overflows from
+   * the layer below during propagation, so it is sized by the number of
+   * counters that can be hashed to from a full buffer below.
+   *
    */
-  std::vector<double> decoded_cnt;
+  std::vector<Util::PendingBuffer<T>> carry;
   /**
-   * @brief For lazy update policy
+   * @brief Maximum number of distinct lazy updates before a flush
    *
    */
-  CarryOver lazy_update;
+  const size_t max_pending;
   /**
    * @brief A time-saving optimization
    * @details If no upper layer counter is set, there is no need to decode.
    *
    */
   bool need_to_decode;
+  /**
+   * @brief Whether `carried_cnt` reflects the current upper layers
+   *
+   */
+  bool decoded;
+  /**
+   * @brief Decoded carry of each overflowed layer-0 counter, i.e., the part
+   * of its value contributed by the upper layers
+   * @details Aligned with `cols[0]`. The rest of the value is read from layer
+   * 0 on query, so updates confined to layer 0 never invalidate it.
+   *
+   */
+  std::vector<T> carried_cnt;
+  /**
+   * @brief Cached coefficient matrix of each layer (except for the last)
+   * @details Only columns of overflowed counters (see `cols`) are kept.
+   *
+   */
+  SpMat *coef;
+  /**
+   * @brief Transpose of `coef`, only built for CGLS
+   *
+   */
+  SpMat *coef_t;
+  /**
+   * @brief Counter index of each column in `coef`
+   *
+   */
+  std::vector<size_t> *cols;
+  /**
+   * @brief Whether status bits of a layer have changed since its `coef` was
+   * built
+   *
+   */
+  std::vector<bool> coef_dirty;
+  /**
+   * @brief Iterative solver of each layer (except for the last), bound to
+   * `coef`
+   *
+   */
+  Eigen::LeastSquaresConjugateGradient<SpMat> *lscg;
+  /**
+   * @brief Direct solver of each layer (except for the last)
+   *
+   */
+  Eigen::SparseQR<Eigen::SparseMatrix<double>, Eigen::COLAMDOrdering<int>>
+      *qr;
+  /**
+   * @brief Last solution of each layer (except for the last), used as the
+   * initial guess of the next solve
+   * @details Aligned with `cols`.
+   *
+   */
+  Eigen::VectorXd *guess;
+  /**
+   * @brief Solver for the layers
+   *
+   */
+  DecodeSolver decode_solver;
+  /**
+   * @brief Layers with no more counters than this use DecodeSolver::QR
+   *
+   */
+  size_t qr_threshold;
+  /**
+   * @brief Time spent on decoding each layer last time (in seconds)
+   *
+   */
+  std::vector<double> decode_time;
 
 private:
   /**
    * @brief Update a layer (aggregation)
    *
-   * @details An overflow error would be thrown if there is an overflow at the
-   * last layer. For the other layers, since a counter may first oveflow and
-   * then be substracted to withdraw any carry over, the number of overflows of
-   * counter whose status bit is set is not assumed to be 1 at least.
+   * @details Carry-in of the current layer is consumed in place and overflows
+   * are accumulated into the carry-in of the next layer. An overflow error
+   * would be thrown if there is an overflow at the last layer. For the other
+   * layers, since a counter may first oveflow and then be substracted to
+   * withdraw any carry over, the number of overflows of counter whose status
+   * bit is set is not assumed to be 1 at least.
    *
    * @param layer   the current layer
-   * @param updates updates to be propagated to the current layer
-   * @return updates to be propagated to the next layer
    */
-  [[nodiscard]] CarryOver updateLayer(const int32_t layer, CarryOver &&updates);
+  void updateLayer(const int32_t layer);
+  /**
+   * @brief Propagate all buffered updates through the layers
+   *
+   */
+  void flush();
   /**
    * @brief Decode a layer
    *
+   * @details The coefficient matrix is rebuilt only if status bits on this
+   * layer have changed, and the solver is warm-started with the last solution.
+   * Layer 0 is not materialized: its decoded carries are kept in `carried_cnt`
+   * and an empty vector is returned.
+   *
    * @param layer   the current layer to decode
    * @param higher  decoded results of the higher layer
    * @return results of the current layer
    */
   [[nodiscard]] std::vector<double>
-  decodeLayer(const int32_t layer, std::vector<double> &&higher) const;
+  decodeLayer(const int32_t layer, std::vector<double> &&higher);
+  /**
+   * @brief Solver used on a layer
+   *
+   */
+  DecodeSolver layerSolver(const int32_t layer) const;
+  /**
+   * @brief Build the coefficient matrix of a layer and set up its solver
+   *
+   */
+  void buildLayer(const int32_t layer);
+  /**
+   * @brief Solve `coef[layer] * x = b` in the least-squares sense with CGLS
+   *
+   * @param layer the current layer
+   * @param b     right-hand side
+   * @param x0    initial guess
+   */
+  Eigen::VectorXd solveCGLS(const int32_t layer, const Eigen::VectorXd &b,
+                            const Eigen::VectorXd &x0) const;
+  /**
+   * @brief Bring `carried_cnt` up to date
+   *
+   */
+  void decode();
+  /**
+   * @brief Decoded carry of a layer-0 counter
+   *
+   */
+  T carriedCnt(size_t index) const;
 
 public:
   /**
@@ -136,6 +266,11 @@ public:
    * @param width_cnt   width of counters on each layer, from low to high
    * @param no_hash     number of hash functions used on each layer, from low
    * to high (except for the last layer)
+   * @param max_pending maximum number of distinct counters being lazily
+   * updated before the updates are propagated in a batch
+   * @param keep_original whether to keep a plain copy of the original counters
+   * for getOriginalCnt(). It takes `sizeof(T)` bytes per counter, so leave it
+   * off unless CH itself is being verified.
    *
    * @details The meaning of the three parameters stipulates the following
    * requirements:
@@ -149,10 +284,12 @@ public:
    * - `no_layer <= 0`
    * - Sum of `width_cnt` exceeds `sizeof(T) * 8`. This constraint is imposed to
    * guarantee proper shifting of counters when decoding.
+   * - `max_pending` is 0.
    */
   CounterHierarchy(const std::vector<size_t> &no_cnt,
                    const std::vector<size_t> &width_cnt,
-                   const std::vector<size_t> &no_hash);
+                   const std::vector<size_t> &no_hash,
+                   size_t max_pending = 4096, bool keep_original = false);
   /**
    * @brief Destructor
    *
@@ -181,18 +318,51 @@ public:
    * index serialized in advance.
    */
   T getCnt(size_t index);
+  /**
+   * @brief Get the values of a batch of counters in CH
+   *
+   * @details Buffered updates are propagated and decoded only once for the
+   * whole batch, and counters are prefetched ahead of use. Exceptions are the
+   * same as getCnt().
+   *
+   * @param index   serialized indices of the counters
+   * @param num     number of counters
+   * @param result  `result[i]` is set to the value of counter `index[i]`
+   */
+  void getCntMany(const size_t *index, size_t num, T *result);
   /**
    * @brief Get the original value of counters.
    *
-   * @details I.e., the value of the counter without CH.
+   * @details I.e., the value of the counter without CH. Only available if
+   * `keep_original` is set on construction; otherwise, an exception is thrown.
    *
    * @param index Serialized index of a counter. It is the user's job to get
    * the index serialized in advance.
    */
   T getOriginalCnt(size_t index) const;
+  /**
+   * @brief Choose the solver for decoding
+   *
+   * @param solver        solver of the layers
+   * @param qr_threshold  layers with at most this many counters use
+   * DecodeSolver::QR regardless of `solver`
+   */
+  void setSolver(DecodeSolver solver, size_t qr_threshold = 0);
+  /**
+   * @brief Decode all layers from scratch, discarding any cached matrix or
+   * solution
+   *
+   * @return time spent on decoding each layer (in seconds), from low to high
+   * (except for the last layer)
+   */
+  std::vector<double> redecode();
   /**
    * @brief Size of CH.
    *
+   * @details Besides the packed counters, status bits and hash functions, it
+   * counts the lazy-update buffers and what is cached from the last decoding,
+   * which grows with the number of overflowed counters. Scratch space used
+   * only during a decoding is not counted.
    */
   size_t size() const;
   /**
@@ -218,38 +388,157 @@ public:
 namespace OmniSketch::Sketch {
 
 template <int32_t no_layer, typename T, typename hash_t>
-typename CounterHierarchy<no_layer, T, hash_t>::CarryOver
-CounterHierarchy<no_layer, T, hash_t>::updateLayer(const int32_t layer,
-                                                   CarryOver &&updates) {
+void CounterHierarchy<no_layer, T, hash_t>::updateLayer(const int32_t layer) {
   // A time-saving optimization
-  if (layer > 0 && !updates.empty()) {
+  if (layer > 0 && !carry[layer].empty()) {
     need_to_decode = true;
+    // upper layers change, so decode from scratch
+    decoded = false;
   }
 
-  CarryOver ret; // aggregate all updates on the current layer
-  for (const auto &kv : updates) {
-    T overflow = cnt_array[layer][kv.first] + kv.second;
+  Util::PendingBuffer<T> &in = carry[layer];
+  for (size_t k = 0; k < in.size(); ++k) {
+    const size_t idx = in.key(k);
+    T val = in.val(k);
+    if (!val)
+      continue; // cancelled out
+    in.val(k) = 0;
+    T overflow = cnt_array[layer].add(idx, val);
     if (overflow) {
       // mark status bits
-      status_bits[layer][kv.first] = true;
+      if (!status_bits[layer][idx]) {
+        status_bits[layer][idx] = true;
+        // the last layer has no coefficient matrix
+        if (layer < no_layer - 1)
+          coef_dirty[layer] = true;
+      }
       if (layer == no_layer - 1) { // last layer
         throw std::overflow_error(
             "Counter overflow at the last layer in CH, overflow by " +
             std::to_string(overflow) + ".");
       } else { // hash to upper-layer counters
+        Util::PendingBuffer<T> &out = carry[layer + 1];
         for (size_t i = 0; i < no_hash[layer]; i++) {
-          std::size_t index = hash_fns[layer][i](kv.first) % no_cnt[layer + 1];
-          ret[index] += overflow;
+          std::size_t index = hash_fns[layer][i](idx) % no_cnt[layer + 1];
+          out.add(index, overflow);
         }
       }
     }
   }
-  return ret;
+  in.clear();
+}
+
+template <int32_t no_layer, typename T, typename hash_t>
+void CounterHierarchy<no_layer, T, hash_t>::flush() {
+  for (int32_t i = 0; i < no_layer; i++) {
+    updateLayer(i); // throw exception
+  }
+}
+
+template <int32_t no_layer, typename T, typename hash_t>
+DecodeSolver
+CounterHierarchy<no_layer, T, hash_t>::layerSolver(const int32_t layer) const {
+  return no_cnt[layer] <= qr_threshold ? QR : decode_solver;
+}
+
+template <int32_t no_layer, typename T, typename hash_t>
+void CounterHierarchy<no_layer, T, hash_t>::buildLayer(const int32_t layer) {
+  // columns are the overflowed counters only
+  std::vector<size_t> &col = cols[layer];
+  std::vector<size_t> old_col;
+  old_col.swap(col);
+  for (size_t i = 0; i < no_cnt[layer]; i++) {
+    if (status_bits[layer][i])
+      col.push_back(i);
+  }
+  // carry the last solution over to the new columns, both sorted
+  Eigen::VectorXd &X = guess[layer];
+  Eigen::VectorXd x0 = Eigen::VectorXd::Zero(col.size());
+  if (X.size() == static_cast<Eigen::Index>(old_col.size())) {
+    for (size_t c = 0, o = 0; c < col.size() && o < old_col.size(); ++c) {
+      while (o < old_col.size() && old_col[o] < col[c])
+        ++o;
+      if (o < old_col.size() && old_col[o] == col[c])
+        x0[c] = X[o];
+    }
+  }
+  X = std::move(x0);
+
+  std::vector<Eigen::Triplet<double>> tripletlist;
+  tripletlist.reserve(col.size() * no_hash[layer]);
+#pragma omp parallel
+  {
+    // per-thread buffer
+    std::vector<Eigen::Triplet<double>> local;
+#pragma omp for nowait schedule(static)
+    for (int64_t c = 0; c < static_cast<int64_t>(col.size()); ++c) {
+      // hash to higher-layer counter
+      for (size_t j = 0; j < no_hash[layer]; ++j) {
+        size_t k = hash_fns[layer][j](col[c]) % no_cnt[layer + 1];
+        local.push_back(Eigen::Triplet<double>(k, c, 1.0));
+      }
+    }
+#pragma omp critical
+    tripletlist.insert(tripletlist.end(), local.begin(), local.end());
+  }
+
+  // duplicates are summed up, see
+  // https://eigen.tuxfamily.org/dox/classEigen_1_1SparseMatrix.html#a8f09e3597f37aa8861599260af6a53e0
+  SpMat &A = coef[layer];
+  A.resize(no_cnt[layer + 1], col.size());
+  A.setFromTriplets(tripletlist.begin(), tripletlist.end());
+  A.makeCompressed();
+  if (col.empty())
+    return; // nothing to solve
+
+  switch (layerSolver(layer)) {
+  case LSCG:
+    lscg[layer].compute(A);
+    break;
+  case CGLS:
+    coef_t[layer] = A.transpose();
+    break;
+  case QR:
+    qr[layer].compute(Eigen::SparseMatrix<double>(A));
+    break;
+  }
+}
+
+template <int32_t no_layer, typename T, typename hash_t>
+Eigen::VectorXd CounterHierarchy<no_layer, T, hash_t>::solveCGLS(
+    const int32_t layer, const Eigen::VectorXd &b,
+    const Eigen::VectorXd &x0) const {
+  const SpMat &A = coef[layer];
+  const SpMat &At = coef_t[layer];
+  // same stopping criteria as Eigen::LeastSquaresConjugateGradient
+  const double threshold = std::pow(Eigen::NumTraits<double>::epsilon(), 2) *
+                           (At * b).squaredNorm();
+  const Eigen::Index max_iter = 2 * A.cols();
+
+  Eigen::VectorXd x = x0;
+  Eigen::VectorXd r = b - A * x;
+  Eigen::VectorXd s = At * r;
+  Eigen::VectorXd p = s, q(A.rows());
+  double gamma = s.squaredNorm();
+  for (Eigen::Index i = 0; i < max_iter && gamma > threshold; ++i) {
+    q.noalias() = A * p;
+    double qq = q.squaredNorm();
+    if (qq == 0.0)
+      break;
+    double alpha = gamma / qq;
+    x += alpha * p;
+    r -= alpha * q;
+    s.noalias() = At * r;
+    double gamma_new = s.squaredNorm();
+    p = s + (gamma_new / gamma) * p;
+    gamma = gamma_new;
+  }
+  return x;
 }
 
 template <int32_t no_layer, typename T, typename hash_t>
 std::vector<double> CounterHierarchy<no_layer, T, hash_t>::decodeLayer(
-    const int32_t layer, std::vector<double> &&higher) const {
+    const int32_t layer, std::vector<double> &&higher) {
   // make sure the size match
   if (higher.size() != no_cnt[layer + 1]) {
     throw std::length_error("Size Error: Expect a vector of size " +
@@ -257,50 +546,85 @@ std::vector<double> CounterHierarchy<no_layer, T, hash_t>::decodeLayer(
                             ", but got one of size " +
                             std::to_string(higher.size()) + " instead.");
   }
+  auto tick = std::chrono::steady_clock::now();
 
-  // solver
-  Eigen::LeastSquaresConjugateGradient<Eigen::SparseMatrix<double>>
-      solver_sparse;
+  Eigen::VectorXd b = Eigen::Map<Eigen::VectorXd, Eigen::Unaligned>(
+      higher.data(), higher.size());
 
-  Eigen::VectorXd X(no_cnt[layer]),
-      b = Eigen::Map<Eigen::VectorXd, Eigen::Unaligned>(higher.data(),
-                                                        higher.size());
-  Eigen::SparseMatrix<double> A(no_cnt[layer + 1], no_cnt[layer]);
-  std::vector<Eigen::Triplet<double>> tripletlist;
-
-  for (size_t i = 0; i < no_cnt[layer]; i++) {
-    if (!status_bits[layer][i])
-      continue; // no overflow
-    // hash to higher-layer counter
-    for (size_t j = 0; j < no_hash[layer]; ++j) {
-      size_t k = hash_fns[layer][j](i) % no_cnt[layer + 1];
-      tripletlist.push_back(Eigen::Triplet<double>(k, i, 1.0));
+  // rebuild the coefficient matrix only if the sparsity pattern changes
+  if (coef_dirty[layer]) {
+    buildLayer(layer);
+    coef_dirty[layer] = false;
+  }
+  // warm start
+  Eigen::VectorXd &X = guess[layer];
+  const std::vector<size_t> &col = cols[layer];
+  if (!col.empty()) {
+    Eigen::VectorXd x;
+    switch (layerSolver(layer)) {
+    case LSCG:
+      x = lscg[layer].solveWithGuess(b, X);
+      break;
+    case CGLS:
+      x = solveCGLS(layer, b, X);
+      break;
+    case QR:
+      x = qr[layer].solve(b);
+      break;
     }
+    X = std::move(x);
   }
-  // duplicates are summed up, see
-  // https://eigen.tuxfamily.org/dox/classEigen_1_1SparseMatrix.html#a8f09e3597f37aa8861599260af6a53e0
-  A.setFromTriplets(tripletlist.begin(), tripletlist.end());
-  A.makeCompressed();
-  solver_sparse.compute(A);
-  X = solver_sparse.solve(b);
 
-  std::vector<double> ret(no_cnt[layer]);
-  for (size_t i = 0; i < no_cnt[layer]; ++i) {
-    ret[i] = status_bits[layer][i]
-                 ? static_cast<double>(static_cast<T>(X[i] + 0.5)
-                                       << width_cnt[layer])
-                 : 0.0;
-    ret[i] += cnt_array[layer][i].getVal();
+  std::vector<double> ret;
+  if (layer == 0) {
+    carried_cnt.resize(col.size());
+    for (size_t c = 0; c < col.size(); ++c) {
+      carried_cnt[c] = static_cast<T>(X[c] + 0.5) << width_cnt[layer];
+    }
+  } else {
+    ret.resize(no_cnt[layer]);
+    for (size_t c = 0; c < col.size(); ++c) {
+      ret[col[c]] = static_cast<double>(static_cast<T>(X[c] + 0.5)
+                                        << width_cnt[layer]);
+    }
+    for (size_t i = 0; i < no_cnt[layer]; ++i) {
+      ret[i] += cnt_array[layer].getVal(i);
+    }
   }
+  decode_time[layer] = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - tick)
+                           .count();
   return ret;
 }
 
+template <int32_t no_layer, typename T, typename hash_t>
+void CounterHierarchy<no_layer, T, hash_t>::decode() {
+  std::vector<double> higher(no_cnt.back());
+  for (size_t i = 0; i < no_cnt.back(); ++i) {
+    higher[i] = static_cast<double>(cnt_array[no_layer - 1].getVal(i));
+  }
+  for (int32_t i = no_layer - 2; i >= 0; i--) {
+    higher = decodeLayer(i, std::move(higher));
+  }
+  decoded = true;
+}
+
+template <int32_t no_layer, typename T, typename hash_t>
+T CounterHierarchy<no_layer, T, hash_t>::carriedCnt(size_t index) const {
+  if (!status_bits[0][index])
+    return 0;
+  auto it = std::lower_bound(cols[0].begin(), cols[0].end(), index);
+  return carried_cnt[it - cols[0].begin()];
+}
+
 template <int32_t no_layer, typename T, typename hash_t>
 CounterHierarchy<no_layer, T, hash_t>::CounterHierarchy(
     const std::vector<size_t> &no_cnt, const std::vector<size_t> &width_cnt,
-    const std::vector<size_t> &no_hash)
+    const std::vector<size_t> &no_hash, size_t max_pending,
+    bool keep_original)
     : no_cnt(no_cnt), width_cnt(width_cnt), no_hash(no_hash),
-      need_to_decode(false) {
+      max_pending(max_pending), need_to_decode(false), decoded(false),
+      decode_solver(LSCG), qr_threshold(0) {
   // validity check
   if (no_layer < 1) {
     throw std::invalid_argument(
@@ -352,34 +676,67 @@ CounterHierarchy<no_layer, T, hash_t>::CounterHierarchy(
     }
     length = tmp;
   }
+  if (max_pending == 0) {
+    throw std::invalid_argument(
+        "Invalid Argument: `max_pending` should be positive.");
+  }
 
   // allocate in heap
   hash_fns = new std::vector<hash_t>[no_layer - 1];
   for (int32_t i = 0; i < no_layer - 1; ++i) {
     hash_fns[i] = std::vector<hash_t>(no_hash[i]);
   }
-  cnt_array = new std::vector<Util::DynamicIntX<T>>[no_layer];
+  cnt_array.reserve(no_layer);
   for (int32_t i = 0; i < no_layer; ++i) {
-    cnt_array[i] = std::vector<Util::DynamicIntX<T>>(no_cnt[i], {width_cnt[i]});
+    cnt_array.emplace_back(no_cnt[i], width_cnt[i]);
   }
   status_bits = new boost::dynamic_bitset<uint8_t>[no_layer];
   for (int32_t i = 0; i < no_layer; ++i) {
     status_bits[i].resize(no_cnt[i], false);
   }
+  // at most `no_hash` carries out of each counter pending on the layer below
+  carry.reserve(no_layer);
+  size_t bound = std::min(max_pending, no_cnt[0]);
+  for (int32_t i = 0; i < no_layer; ++i) {
+    if (i > 0) {
+      bound = (bound > no_cnt[i] / no_hash[i - 1]) ? no_cnt[i]
+                                                    : bound * no_hash[i - 1];
+    }
+    carry.emplace_back(bound);
+  }
+  // decoding caches
+  coef = new SpMat[no_layer - 1];
+  coef_t = new SpMat[no_layer - 1];
+  cols = new std::vector<size_t>[no_layer - 1];
+  coef_dirty.resize(no_layer - 1, true);
+  lscg = new Eigen::LeastSquaresConjugateGradient<SpMat>[no_layer - 1];
+  qr = new Eigen::SparseQR<Eigen::SparseMatrix<double>,
+                           Eigen::COLAMDOrdering<int>>[no_layer - 1];
+  guess = new Eigen::VectorXd[no_layer - 1];
+  decode_time.resize(no_layer - 1);
   // original counters, value initialized
-  original_cnt.resize(no_cnt[0]);
-  // decoded counters, value initialized
-  decoded_cnt.resize(no_cnt[0]);
+  if (keep_original)
+    original_cnt.resize(no_cnt[0]);
 }
 
 template <int32_t no_layer, typename T, typename hash_t>
 CounterHierarchy<no_layer, T, hash_t>::~CounterHierarchy() {
   if (hash_fns)
     delete[] hash_fns;
-  if (cnt_array)
-    delete[] cnt_array;
   if (status_bits)
     delete[] status_bits;
+  if (lscg)
+    delete[] lscg;
+  if (qr)
+    delete[] qr;
+  if (coef)
+    delete[] coef;
+  if (coef_t)
+    delete[] coef_t;
+  if (cols)
+    delete[] cols;
+  if (guess)
+    delete[] guess;
 }
 
 template <int32_t no_layer, typename T, typename hash_t>
@@ -390,9 +747,13 @@ void CounterHierarchy<no_layer, T, hash_t>::updateCnt(size_t index, T val) {
                             std::to_string(index) + " instead.");
   }
   // lazy update policy
-  lazy_update[index] += val;
+  carry[0].add(index, val);
   // original counters
-  original_cnt[index] += val;
+  if (!original_cnt.empty())
+    original_cnt[index] += val;
+  // bounded buffer
+  if (carry[0].size() >= max_pending)
+    flush(); // throw exception
 }
 
 template <int32_t no_layer, typename T, typename hash_t>
@@ -404,38 +765,91 @@ T CounterHierarchy<no_layer, T, hash_t>::getCnt(size_t index) {
   }
 
   // lazy update
-  if (!lazy_update.empty()) {
-    for (int32_t i = 0; i < no_layer; i++) {
-      lazy_update = updateLayer(i, std::move(lazy_update)); // throw exception
+  if (!carry[0].empty()) {
+    flush(); // throw exception
+  }
+  // A time-saving optimization
+  if (!need_to_decode)
+    return cnt_array[0].getVal(index);
+  // decode
+  if (!decoded) {
+    decode();
+  }
+  return cnt_array[0].getVal(index) + carriedCnt(index);
+}
+
+template <int32_t no_layer, typename T, typename hash_t>
+void CounterHierarchy<no_layer, T, hash_t>::getCntMany(const size_t *index,
+                                                       size_t num, T *result) {
+  // # counters prefetched ahead
+  constexpr size_t ahead = 8;
+  for (size_t i = 0; i < num; ++i) {
+    if (index[i] >= no_cnt[0]) {
+      throw std::out_of_range("Index Out of Range: Should be in [0, " +
+                              std::to_string(no_cnt[0] - 1) + "], but got " +
+                              std::to_string(index[i]) + " instead.");
     }
-    lazy_update.clear();
-    // A time-saving optimization
-    if (!need_to_decode) {
-      return cnt_array[0][index].getVal();
-    } else { // decode
-      decoded_cnt = std::vector<double>(no_cnt.back());
-      for (size_t i = 0; i < no_cnt.back(); ++i) {
-        decoded_cnt[i] =
-            static_cast<double>(cnt_array[no_layer - 1][i].getVal());
-      }
-      for (int32_t i = no_layer - 2; i >= 0; i--) {
-        decoded_cnt = decodeLayer(i, std::move(decoded_cnt));
-      }
-      return static_cast<T>(decoded_cnt[index]);
+  }
+
+  // lazy update
+  if (!carry[0].empty()) {
+    flush(); // throw exception
+  }
+  // A time-saving optimization
+  if (!need_to_decode) {
+    for (size_t i = 0; i < num; ++i) {
+      if (i + ahead < num)
+        cnt_array[0].prefetch(index[i + ahead]);
+      result[i] = cnt_array[0].getVal(index[i]);
     }
-    // always return
+    return;
+  }
+  // decode
+  if (!decoded) {
+    decode();
+  }
+  for (size_t i = 0; i < num; ++i) {
+    if (i + ahead < num)
+      cnt_array[0].prefetch(index[i + ahead]);
+    result[i] = cnt_array[0].getVal(index[i]) + carriedCnt(index[i]);
   }
-  // no lazy update
-  if (!need_to_decode)
-    return cnt_array[0][index].getVal();
-  return static_cast<T>(decoded_cnt[index]);
 }
 
 template <int32_t no_layer, typename T, typename hash_t>
 T CounterHierarchy<no_layer, T, hash_t>::getOriginalCnt(size_t index) const {
+  if (original_cnt.empty()) {
+    throw std::runtime_error(
+        "Runtime Error: Original counters are not kept in this CH.");
+  }
   return original_cnt[index];
 }
 
+template <int32_t no_layer, typename T, typename hash_t>
+void CounterHierarchy<no_layer, T, hash_t>::setSolver(DecodeSolver solver,
+                                                      size_t qr_threshold) {
+  decode_solver = solver;
+  this->qr_threshold = qr_threshold;
+  // solvers have to be set up again
+  for (int32_t i = 0; i < no_layer - 1; ++i) {
+    coef_dirty[i] = true;
+  }
+  decoded = false;
+}
+
+template <int32_t no_layer, typename T, typename hash_t>
+std::vector<double> CounterHierarchy<no_layer, T, hash_t>::redecode() {
+  if (!carry[0].empty()) {
+    flush(); // throw exception
+  }
+  for (int32_t i = 0; i < no_layer - 1; ++i) {
+    coef_dirty[i] = true;
+    guess[i].resize(0);
+  }
+  decoded = false;
+  decode();
+  return decode_time;
+}
+
 template <int32_t no_layer, typename T, typename hash_t>
 size_t CounterHierarchy<no_layer, T, hash_t>::size() const {
   // counters + status bits
@@ -449,6 +863,21 @@ size_t CounterHierarchy<no_layer, T, hash_t>::size() const {
   for (int32_t i = 0; i < no_layer - 1; ++i) {
     tot += sizeof(hash_t) * no_hash[i];
   }
+  // lazy-update buffers
+  for (int32_t i = 0; i < no_layer; ++i) {
+    tot += carry[i].bytes();
+  }
+  // decoding caches
+  auto matrix = [](const SpMat &A) {
+    return A.nonZeros() * (sizeof(double) + sizeof(SpMat::StorageIndex)) +
+           (A.outerSize() + 1) * sizeof(SpMat::StorageIndex);
+  };
+  for (int32_t i = 0; i < no_layer - 1; ++i) {
+    tot += matrix(coef[i]) + matrix(coef_t[i]);
+    tot += sizeof(size_t) * cols[i].size();
+    tot += sizeof(double) * guess[i].size();
+  }
+  tot += sizeof(T) * carried_cnt.size();
   return tot;
 }
 
@@ -461,20 +890,27 @@ template <int32_t no_layer, typename T, typename hash_t>
 void CounterHierarchy<no_layer, T, hash_t>::clear() {
   // reset counters
   for (int32_t i = 0; i < no_layer; ++i) {
-    cnt_array[i] = std::vector<Util::DynamicIntX<T>>(no_cnt[i], width_cnt[i]);
+    cnt_array[i].clear();
   }
   // reset status bits
   for (int32_t i = 0; i < no_layer; ++i) {
     status_bits[i].reset();
   }
-  // reset original counters
-  original_cnt = std::vector<T>(no_cnt[0]);
-  // // reset decoded counters
-  // decoded_cnt = std::vector<double>(no_cnt[0]);
-  // reset lazy_update
-  lazy_update.clear();
+  // reset original counters in place
+  std::fill(original_cnt.begin(), original_cnt.end(), 0);
+  // reset lazy updates and carry-in
+  for (int32_t i = 0; i < no_layer; ++i) {
+    carry[i].clear();
+  }
   // reset tag
   need_to_decode = false;
+  decoded = false;
+  // reset decoding caches
+  carried_cnt.clear();
+  for (int32_t i = 0; i < no_layer - 1; ++i) {
+    coef_dirty[i] = true;
+    guess[i].resize(0);
+  }
 }
 
 } // namespace OmniSketch::Sketch
\ No newline at end of file
@@ -0,0 +1,118 @@
+/**
+ * @file perf.h
+ * @author dromniscience (you@domain.com)
+ * @brief Hardware event counters of the calling thread
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace OmniSketch::Util {
+/**
+ * @brief Count a hardware event of the calling thread with `perf_event_open`
+ *
+ * @details The counter may be unavailable, e.g., in a container, in a VM
+ * without a virtual PMU, or if `/proc/sys/kernel/perf_event_paranoid` forbids
+ * it. Then valid() is `false` and the counter reads 0. Only user-space events
+ * are counted.
+ */
+class PerfCounter {
+public:
+  /**
+   * @brief Events that can be counted
+   *
+   */
+  enum Event { DTLB_LOAD_MISS, DTLB_STORE_MISS };
+
+private:
+  int fd;
+
+  PerfCounter(const PerfCounter &) = delete;
+  PerfCounter(PerfCounter &&) = delete;
+  PerfCounter &operator=(PerfCounter) = delete;
+
+public:
+  /**
+   * @brief Open a counter of certain event
+   *
+   */
+  PerfCounter(Event event) : fd(-1) {
+#if defined(__linux__)
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) |
+                  ((event == DTLB_LOAD_MISS ? PERF_COUNT_HW_CACHE_OP_READ
+                                            : PERF_COUNT_HW_CACHE_OP_WRITE)
+                   << 8);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+  }
+  /**
+   * @brief Close the counter
+   *
+   */
+  ~PerfCounter() {
+#if defined(__linux__)
+    if (fd >= 0)
+      close(fd);
+#endif
+  }
+  /**
+   * @brief Whether the event can be counted
+   *
+   */
+  bool valid() const { return fd >= 0; }
+  /**
+   * @brief Reset to zero and start counting
+   *
+   */
+  void start() {
+#if defined(__linux__)
+    if (fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+  /**
+   * @brief Stop counting
+   *
+   */
+  void stop() {
+#if defined(__linux__)
+    if (fd >= 0)
+      ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+#endif
+  }
+  /**
+   * @brief # events counted between start() and stop()
+   *
+   */
+  uint64_t value() const {
+    uint64_t count = 0;
+#if defined(__linux__)
+    if (fd >= 0 && read(fd, &count, sizeof(count)) != sizeof(count))
+      count = 0;
+#endif
+    return count;
+  }
+};
+
+} // namespace OmniSketch::Util
@@ -0,0 +1,107 @@
+/**
+ * @file ring.h
+ * @author dromniscience (you@domain.com)
+ * @brief Lock-free single-producer single-consumer ring
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+
+namespace OmniSketch::Util {
+/**
+ * @brief Bounded lock-free queue between exactly one producer thread and one
+ * consumer thread
+ *
+ * @details The head is written only by the consumer and the tail only by the
+ * producer, each on its own cache line. Both sides also keep a private copy of
+ * the other's index and reload it only when the ring looks full (or empty), so
+ * in the steady state an operation touches no shared cache line but the slot
+ * itself.
+ *
+ * @tparam T  type of the element, should be copy-assignable
+ */
+template <typename T> class SPSCRing {
+private:
+  const size_t capacity;
+  const size_t mask;
+  T *buffer;
+
+  alignas(64) std::atomic<size_t> head; // next slot to pop
+  size_t cached_tail;                   // consumer's copy of tail
+  alignas(64) std::atomic<size_t> tail; // next slot to push
+  size_t cached_head;                   // producer's copy of head
+
+  SPSCRing(const SPSCRing &) = delete;
+  SPSCRing(SPSCRing &&) = delete;
+  SPSCRing &operator=(SPSCRing) = delete;
+
+  static size_t roundUp(size_t n) {
+    size_t ret = 1;
+    while (ret < n)
+      ret <<= 1;
+    return ret;
+  }
+
+public:
+  /**
+   * @brief Construct by specifying the least number of elements to hold
+   *
+   * @param capacity_ rounded up to a power of 2
+   */
+  SPSCRing(size_t capacity_)
+      : capacity(roundUp(capacity_)), mask(capacity - 1), head(0),
+        cached_tail(0), tail(0), cached_head(0) {
+    if (capacity_ == 0) {
+      throw std::invalid_argument(
+          "Invalid Argument: Ring should hold at least 1 element.");
+    }
+    buffer = new T[capacity];
+  }
+  /**
+   * @brief Release the buffer
+   *
+   */
+  ~SPSCRing() { delete[] buffer; }
+  /**
+   * @brief Append an element. Only the producer may call it.
+   * @return `false` if the ring is full, in which case nothing is done.
+   */
+  bool tryPush(const T &val) {
+    const size_t t = tail.load(std::memory_order_relaxed);
+    if (t - cached_head == capacity) {
+      cached_head = head.load(std::memory_order_acquire);
+      if (t - cached_head == capacity)
+        return false;
+    }
+    buffer[t & mask] = val;
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+  /**
+   * @brief Remove the oldest element. Only the consumer may call it.
+   * @return `false` if the ring is empty, in which case `val` is untouched.
+   */
+  bool tryPop(T &val) {
+    const size_t h = head.load(std::memory_order_relaxed);
+    if (h == cached_tail) {
+      cached_tail = tail.load(std::memory_order_acquire);
+      if (h == cached_tail)
+        return false;
+    }
+    val = buffer[h & mask];
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+  /**
+   * @brief Number of elements the ring can hold
+   *
+   */
+  size_t size() const { return capacity; }
+};
+
+} // namespace OmniSketch::Util
@@ -10,6 +10,7 @@
 
 // A bunch of files to include!
 #include "data.h"
+#include <boost/dynamic_bitset.hpp>
 
 /**
  * @brief Warehouse of sketches
@@ -49,10 +50,22 @@ namespace OmniSketch::Sketch {
  *        <td>update(const FlowKey<key_len> &, T)</td>
  *   </tr>
  *   <tr>
+ *        <td>query a batch of flowkeys</td>
+ *        <td>
+ * queryMany(const FlowKey<key_len> *, size_t, std::vector<T> &) const
+ *        </td>
+ *   </tr>
+ *   <tr>
  *        <td>look up a flowkey (*if exists*)</td>
  *        <td>lookup(const FlowKey<key_len> &) const</td>
  *   </tr>
  *   <tr>
+ *        <td>look up a batch of flowkeys</td>
+ *        <td>
+ * lookupMany(const FlowKey<key_len> *, size_t, boost::dynamic_bitset<> &) const
+ *        </td>
+ *   </tr>
+ *   <tr>
  *        <td>heavy hitter</td>
  *        <td>getHeavyHitter(double) const</td>
  *   </tr>
@@ -66,6 +79,10 @@ namespace OmniSketch::Sketch {
  *        <td>decode flowkeys with values</td>
  *        <td>decode()</td>
  *   </tr>
+ *   <tr>
+ *        <td>reset to an empty sketch</td>
+ *        <td>clear()</td>
+ *   </tr>
  * </table>
  *
  */
@@ -119,6 +136,23 @@ public:
     }
     return 0;
   }
+  /**
+   * @brief Query a batch of flowkeys
+   * @details By default it calls query() on each flowkey in turn. Override it
+   * if the sketch can answer a batch faster.
+   *
+   * @param flowkeys  pointer to the first flowkey
+   * @param num       number of flowkeys
+   * @param result    `result[i]` is the estimated size of `flowkeys[i]`
+   * (resized to `num`)
+   */
+  virtual void queryMany(const FlowKey<key_len> *flowkeys, size_t num,
+                         std::vector<T> &result) const {
+    result.resize(num);
+    for (size_t i = 0; i < num; ++i) {
+      result[i] = query(flowkeys[i]);
+    }
+  }
   /**
    * @brief Look up a flowkey in the sketch
    * @return `true` means there exists; `false` otherwise.
@@ -131,6 +165,24 @@ public:
     }
     return false;
   }
+  /**
+   * @brief Look up a batch of flowkeys in the sketch
+   * @details By default it calls lookup() on each flowkey in turn. Override it
+   * if the sketch can resolve a batch faster, e.g., by overlapping memory
+   * accesses of different flowkeys.
+   *
+   * @param flowkeys  pointer to the first flowkey
+   * @param num       number of flowkeys
+   * @param result    `result[i]` is set iff `flowkeys[i]` exists (resized to
+   * `num`)
+   */
+  virtual void lookupMany(const FlowKey<key_len> *flowkeys, size_t num,
+                          boost::dynamic_bitset<> &result) const {
+    result.resize(num);
+    for (size_t i = 0; i < num; ++i) {
+      result[i] = lookup(flowkeys[i]);
+    }
+  }
   /**
    * @brief Get all the heavy hitters
    * @return See Data::Estimation for more info.
@@ -171,6 +223,20 @@ public:
     }
     return {};
   }
+  /**
+   * @brief Reset the sketch to its state right after construction
+   * @details Hashing classes are kept, so that a sketch can be reused across
+   * measurement epochs.
+   *
+   */
+  virtual void clear() {
+    static bool emit = false; // avoid burst of LOG
+    if (!emit) {
+      LOG(ERROR, "Erroneously called SketchBase::clear().");
+      emit = true;
+    }
+    return;
+  }
 };
 
 } // namespace OmniSketch::Sketch
\ No newline at end of file
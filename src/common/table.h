@@ -0,0 +1,137 @@
+/**
+ * @file table.h
+ * @author dromniscience (you@domain.com)
+ * @brief Row-major table of counters
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include "alloc.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+namespace OmniSketch::Util {
+/**
+ * @brief Row-major table of counters, zero initialized
+ *
+ * @details Either dimension may be fixed at compile time by a positive
+ * template argument, in which case rows() or cols() is a constant and loops
+ * over rows unroll and modulo by the width becomes a multiplication. If both
+ * are fixed, cells are stored inside the object in a single 64-byte aligned
+ * array instead of on the heap. Such a table can be large, so allocate its
+ * owner with `new` rather than on the stack. Otherwise, cells are allocated by
+ * the policy `alloc_t` (see alloc.h).
+ *
+ * @tparam T        type of the counter
+ * @tparam Rows     # rows if fixed at compile time; 0 otherwise
+ * @tparam Cols     # columns if fixed at compile time; 0 otherwise
+ * @tparam alloc_t  allocation policy of the cells on the heap
+ */
+template <typename T, int32_t Rows = 0, int32_t Cols = 0,
+          typename alloc_t = DefaultAlloc>
+class Table {
+private:
+  /**
+   * @brief Whether cells are stored inside the object
+   *
+   */
+  static constexpr bool FIXED = Rows > 0 && Cols > 0;
+  /**
+   * @brief Storage of a fixed table
+   *
+   */
+  struct alignas(64) Array {
+    T cell[FIXED ? static_cast<size_t>(Rows) * Cols : 1];
+  };
+
+  const int32_t num_row;
+  const int32_t num_col;
+  std::conditional_t<FIXED, Array, T *> cells;
+
+  Table(const Table &) = delete;
+  Table(Table &&) = delete;
+  Table &operator=(Table) = delete;
+
+public:
+  /**
+   * @brief Construct by specifying the dimensions
+   * @details A dimension fixed at compile time must agree with the argument.
+   */
+  Table(int32_t rows, int32_t cols) : num_row(rows), num_col(cols) {
+    if ((Rows > 0 && rows != Rows) || (Cols > 0 && cols != Cols)) {
+      throw std::invalid_argument(
+          "Invalid Argument: Table should be " + std::to_string(Rows) + " * " +
+          std::to_string(Cols) + " as fixed in the template (0 for any), but " +
+          "got " + std::to_string(rows) + " * " + std::to_string(cols) +
+          " instead.");
+    }
+    if constexpr (FIXED) {
+      clear();
+    } else {
+      cells = alloc_t::template allocate<T>(numCell()); // Init with zero
+    }
+  }
+  /**
+   * @brief Release the cells
+   *
+   */
+  ~Table() {
+    if constexpr (!FIXED) {
+      alloc_t::deallocate(cells, numCell());
+    }
+  }
+  /**
+   * @brief # rows
+   *
+   */
+  int32_t rows() const { return Rows > 0 ? Rows : num_row; }
+  /**
+   * @brief # columns
+   *
+   */
+  int32_t cols() const { return Cols > 0 ? Cols : num_col; }
+  /**
+   * @brief # cells
+   *
+   */
+  size_t numCell() const { return static_cast<size_t>(rows()) * cols(); }
+  /**
+   * @brief Pointer to the first cell
+   *
+   */
+  T *data() {
+    if constexpr (FIXED) {
+      return cells.cell;
+    } else {
+      return cells;
+    }
+  }
+  const T *data() const { return const_cast<Table *>(this)->data(); }
+  /**
+   * @brief Pointer to the first cell of a row
+   *
+   */
+  T *operator[](int32_t row) {
+    return data() + static_cast<size_t>(row) * cols();
+  }
+  const T *operator[](int32_t row) const {
+    return data() + static_cast<size_t>(row) * cols();
+  }
+  /**
+   * @brief Size of the cells on the heap (in bytes)
+   * @details 0 if cells are stored inside the instance, in which case they are
+   * counted in the size of the instance (and its owner).
+   */
+  size_t size() const { return FIXED ? 0 : sizeof(T) * numCell(); }
+  /**
+   * @brief Reset all cells to zero
+   *
+   */
+  void clear() { std::fill(data(), data() + numCell(), T()); }
+};
+
+} // namespace OmniSketch::Util
@@ -9,12 +9,16 @@
 #pragma once
 
 // A bunch of files to include!
+#include "epoch.h"
 #include "sketch.h"
 #include <boost/any.hpp>
 #include <ctime>
+#include <deque>
+#include <functional>
 #include <map>
 #include <memory>
 #include <set>
+#include <unordered_map>
 
 /**
  * @brief Testing classes and metrics
@@ -182,6 +186,25 @@ public:
  *        <td>TIME, RATIO, ARE, AAE, ACC, PODF, DIST</td>
  *        <td>`decode`</td>
  *   </tr>
+ *   <tr>
+ *        <td>testEpoch()</td>
+ *        <td>
+ * [update()](@ref Sketch::SketchBase::update()),
+ * [queryMany()](@ref Sketch::SketchBase::queryMany()),
+ * [clear()](@ref Sketch::SketchBase::clear())
+ *        </td>
+ *        <td>RATE, ARE, AAE</td>
+ *        <td>`epoch`</td>
+ *   </tr>
+ *   <tr>
+ *        <td>testSlidingWindow()</td>
+ *        <td>
+ * [update()](@ref Sketch::SketchBase::update()),
+ * [queryMany()](@ref Sketch::SketchBase::queryMany())
+ *        </td>
+ *        <td>RATE, ARE, AAE</td>
+ *        <td>`epoch`</td>
+ *   </tr>
  * </table>
  *
  */
@@ -197,6 +220,7 @@ private:
   Vec heavy_hitter;
   Vec heavy_changer;
   Vec decode;
+  Vec epoch;
 
 protected:
   const std::string_view show_name;
@@ -290,6 +314,8 @@ public:
   /**
    * @brief Query for each flow in ground truth
    * @details You should override the Sketch::SketchBase::query() method.
+   * All flows are queried in a single batch via
+   * Sketch::SketchBase::queryMany(), which may be overriden as well.
    *
    * @param ptr_sketch  pointer to the sketch
    * @param gnd_truth   ground truth
@@ -300,6 +326,8 @@ public:
   /**
    * @brief Lookup each flow in ground truth
    * @details You should override the Sketch::SketchBase::lookup() method.
+   * All flows are looked up in a single batch via
+   * Sketch::SketchBase::lookupMany(), which may be overriden as well.
    *
    * @param ptr_sketch  pointer to the sketch
    * @param gnd_truth   ground truth
@@ -322,6 +350,30 @@ public:
   testHeavyHitter(std::unique_ptr<Sketch::SketchBase<key_len, T>> &ptr_sketch,
                   double threshold,
                   Data::GndTruth<key_len, T> gnd_truth_heavy_hitters) final;
+  /**
+   * @brief Test heavy hitters as defined in the config
+   * @details Heavy hitters are found in the ground truth by `hx_method`. The
+   * threshold given to the sketch is the smallest true heavy hitter for
+   * Data::TopK, and the same fraction of the total value for
+   * Data::Percentile.
+   *
+   * @param ptr_sketch        pointer to the sketch
+   * @param gnd_truth         ground truth
+   * @param num_heavy_hitter  `threshold_heavy_hitter` in the config
+   * @param hx_method         how heavy hitters are defined
+   */
+  void
+  testHeavyHitter(std::unique_ptr<Sketch::SketchBase<key_len, T>> &ptr_sketch,
+                  const Data::GndTruth<key_len, T> &gnd_truth,
+                  double num_heavy_hitter, Data::HXMethod hx_method);
+  /**
+   * @brief Parse `threshold_heavy_hitter` and `hx_method` at the working node
+   *
+   * @return whether both are parsed
+   */
+  static bool parseHeavyHitter(Util::ConfigParser &parser,
+                               double &num_heavy_hitter,
+                               Data::HXMethod &hx_method);
   /**
    * @brief Test heavy changers
    * @details You should override the Sketch::SketchBase::getHeavyChangers()
@@ -348,8 +400,131 @@ public:
   virtual void
   testDecode(std::unique_ptr<Sketch::SketchBase<key_len, T>> &ptr_sketch,
              Data::GndTruth<key_len, T> gnd_truth) final;
+  /**
+   * @brief Update and query window by window, as cut by timestamps
+   * @details Records in [begin, end) are cut into windows of `window`
+   * microseconds, one starting every `slide` microseconds since the first
+   * timestamp. They are tumbling windows if `slide` equals `window`, and
+   * sliding ones if `slide` divides `window`. A record updates every window
+   * that contains it. Window `k` is kept by the current sketch of rotator
+   * `k % (window / slide)` (see Util::EpochRotator), which rotates as soon as
+   * the window closes. The closed window is then queried, while the sketch of
+   * an earlier window is cleared in background.
+   *
+   * Accuracy and update rate of every non-empty window are printed once it
+   * closes, and their means are collected. Records of a slide are timed as a
+   * batch. The trace ends with the oldest open window, which may be cut
+   * short. You should override the Sketch::SketchBase::clear() method.
+   *
+   * @param ptr_sketches  `3 * window / slide` sketches of identical
+   * configuration, three for each rotator
+   * @param begin         [begin, end)
+   * @param end           [begin, end)
+   * @param cnt_method    how records are counted
+   * @param window        length of a window (in microseconds)
+   * @param slide         distance between the starts of consecutive windows
+   * (in microseconds)
+   */
+  virtual void testEpoch(
+      std::vector<std::unique_ptr<Sketch::SketchBase<key_len, T>>>
+          ptr_sketches,
+      typename std::vector<Data::Record<key_len>>::const_iterator begin,
+      typename std::vector<Data::Record<key_len>>::const_iterator end,
+      Data::CntMethod cnt_method, int64_t window, int64_t slide) final;
+  /**
+   * @brief Update and query a sketch that covers a sliding window itself
+   * @details Records in [begin, end) are cut into slides of `slide`
+   * microseconds since the first timestamp, as in testEpoch(). Before each
+   * record updates the sketch, `advance` is called with its timestamp to move
+   * the clock of the sketch. Once a slide ends, the clock is moved to the
+   * slide, which may have no records, and the sketch is queried and compared
+   * with the ground truth of the last `window` microseconds (shorter at the
+   * start of the trace).
+   *
+   * Accuracy of every non-empty window is printed, and its mean is collected
+   * in the same metrics as testEpoch(). The update rate, including
+   * `advance`, is timed in batches of a slide.
+   *
+   * @param ptr_sketch    pointer to the sketch
+   * @param advance       move the clock of the sketch to a timestamp
+   * @param begin         [begin, end)
+   * @param end           [begin, end)
+   * @param cnt_method    how records are counted
+   * @param window        length of the window (in microseconds)
+   * @param slide         distance the window slides by (in microseconds)
+   */
+  virtual void testSlidingWindow(
+      std::unique_ptr<Sketch::SketchBase<key_len, T>> &ptr_sketch,
+      const std::function<void(int64_t)> &advance,
+      typename std::vector<Data::Record<key_len>>::const_iterator begin,
+      typename std::vector<Data::Record<key_len>>::const_iterator end,
+      Data::CntMethod cnt_method, int64_t window, int64_t slide) final;
+
+private:
+  /**
+   * @brief Ground truth of a window
+   *
+   */
+  using Summary = std::unordered_map<FlowKey<key_len>, T>;
+  /**
+   * @brief Replay records slide by slide, maintaining the ground truth of the
+   * last `num_slide` slides
+   * @details Records in [begin, end) are cut into slides of `slide`
+   * microseconds since the first timestamp. They are assumed to be sorted by
+   * timestamp; a late record is counted in the latest slide.
+   * - `ingest(k, first, last)` is called with the records [first, last) of
+   * every non-empty slide `k`.
+   * - `close(k, truth, num_record, is_last)` is called once slide `k` ends,
+   * with the ground truth and # records of slides `[k - num_slide + 1, k]`,
+   * unless they are all empty. `is_last` tells whether the trace ends here.
+   *
+   * The ground truth is maintained incrementally, as a running sum of
+   * per-slide summaries.
+   */
+  template <typename ingest_t, typename close_t>
+  void replaySlides(
+      typename std::vector<Data::Record<key_len>>::const_iterator begin,
+      typename std::vector<Data::Record<key_len>>::const_iterator end,
+      Data::CntMethod cnt_method, int64_t slide, int64_t num_slide,
+      ingest_t &&ingest, close_t &&close) const;
+  /**
+   * @brief ARE and AAE of a sketch over the flows of a window
+   *
+   */
+  std::pair<double, double>
+  windowError(const Sketch::SketchBase<key_len, T> &sketch,
+              const Summary &truth) const;
 };
 
+/**
+ * @brief Tag of a type, passed to a generic lambda
+ *
+ */
+template <typename S> struct TypeTag { using type = S; };
+
+/**
+ * @brief Make a sketch whose two dimensions are fixed in the template if the
+ * config agrees with them, and given on construction otherwise
+ *
+ * @details The driver fixes them as in its default config, with the second
+ * one rounded up to a prime as the sketches do at runtime. If a driver with
+ * fixed dimensions falls back to runtime ones, a warning is logged once.
+ *
+ * @tparam base_t   base class of the sketch
+ * @tparam sketch_t `sketch_t<D1, D2>` has its dimensions fixed to `D1` and
+ * `D2`, and `sketch_t<0, 0>` takes them on construction
+ * @tparam D1       first dimension fixed in the driver, 0 if not fixed
+ * @tparam D2       second dimension fixed in the driver, 0 if not fixed
+ * @param d1        first dimension in the config
+ * @param d2        second dimension in the config
+ * @param make      `make(TypeTag<S>(), d2)` constructs a sketch of type `S`
+ * with the second dimension `d2`, and returns it in a `std::unique_ptr`
+ */
+template <typename base_t, template <int32_t, int32_t> class sketch_t,
+          int32_t D1, int32_t D2, typename make_t>
+std::unique_ptr<base_t> makeFixedSketch(int32_t d1, int32_t d2,
+                                        make_t &&make);
+
 } // namespace OmniSketch::Test
 
 //-----------------------------------------------------------------------------
@@ -502,6 +677,8 @@ template <int32_t key_len, typename T> void TestBase<key_len, T>::show() const {
   foo(heavy_changer, "HC");
   // decode
   foo(decode, "Decode");
+  // epoch
+  foo(epoch, "Epoch");
   // epilogue
   fmt::print("============================================\n");
 }
@@ -558,15 +735,26 @@ void TestBase<key_len, T>::testQuery(
   // config
   MetricVec metric_vec(config_file, test_path, "query");
 
+  // flowkeys are queried in a batch
+  std::vector<FlowKey<key_len>> flowkeys;
+  flowkeys.reserve(gnd_truth.size());
+  for (const auto &kv : gnd_truth) {
+    flowkeys.push_back(kv.get_left());
+  }
+  std::vector<T> estimated;
+
   DEFINE_TIMERS;
+  START_TIMER;
+  ptr_sketch->queryMany(flowkeys.data(), flowkeys.size(), estimated);
+  STOP_TIMER;
+
   double ARE = 0.0, AAE = 0.0, corr = 0, podf_cnt = 0;
   const bool measure_dist = metric_vec.in(Metric::DIST);
   std::vector<double> dist(metric_vec.quantiles.size()); // zero initialized
 
+  size_t i = 0;
   for (const auto &kv : gnd_truth) {
-    START_TIMER;
-    T estimated_size = ptr_sketch->query(kv.get_left());
-    STOP_TIMER;
+    T estimated_size = estimated[i++];
     // update RE, AE, Correct Rate, PODF
     double RE = static_cast<double>(std::abs(kv.get_right() - estimated_size)) /
                 kv.get_right();
@@ -614,15 +802,24 @@ void TestBase<key_len, T>::testLookup(
   // config
   MetricVec metric_vec(config_file, test_path, "lookup");
 
+  // flowkeys are looked up in a batch
+  std::vector<FlowKey<key_len>> flowkeys;
+  flowkeys.reserve(gnd_truth.size());
+  for (const auto &kv : gnd_truth) {
+    flowkeys.push_back(kv.get_left());
+  }
+  boost::dynamic_bitset<> existed;
+
   DEFINE_TIMERS;
+  START_TIMER;
+  ptr_sketch->lookupMany(flowkeys.data(), flowkeys.size(), existed);
+  STOP_TIMER;
+
   double TP = 0.0, FP = 0.0;
-  for (const auto &kv : gnd_truth) {
-    START_TIMER;
-    bool existed = ptr_sketch->lookup(kv.get_left());
-    STOP_TIMER;
+  for (size_t i = 0; i < flowkeys.size(); ++i) {
     // update TP, FP
-    if (existed) {
-      if (sample.count(kv.get_left()))
+    if (existed[i]) {
+      if (sample.count(flowkeys[i]))
         TP += 1.0;
       else
         FP += 1.0;
@@ -643,6 +840,35 @@ void TestBase<key_len, T>::testLookup(
   }
 }
 
+template <int32_t key_len, typename T>
+void TestBase<key_len, T>::testHeavyHitter(
+    std::unique_ptr<Sketch::SketchBase<key_len, T>> &ptr_sketch,
+    const Data::GndTruth<key_len, T> &gnd_truth, double num_heavy_hitter,
+    Data::HXMethod hx_method) {
+  Data::GndTruth<key_len, T> gnd_truth_heavy_hitters;
+  gnd_truth_heavy_hitters.getHeavyHitter(gnd_truth, num_heavy_hitter,
+                                         hx_method);
+  const double threshold =
+      hx_method == Data::TopK
+          ? gnd_truth_heavy_hitters.min()
+          // gnd_truth_heavy_hitter: >, yet the sketch: >=
+          : std::floor(gnd_truth.totalValue() * num_heavy_hitter + 1);
+  testHeavyHitter(ptr_sketch, threshold, std::move(gnd_truth_heavy_hitters));
+}
+
+template <int32_t key_len, typename T>
+bool TestBase<key_len, T>::parseHeavyHitter(Util::ConfigParser &parser,
+                                            double &num_heavy_hitter,
+                                            Data::HXMethod &hx_method) {
+  std::string method;
+  if (!parser.parseConfig(num_heavy_hitter, "threshold_heavy_hitter"))
+    return false;
+  if (!parser.parseConfig(method, "hx_method"))
+    return false;
+  hx_method = method.compare("Percentile") ? Data::TopK : Data::Percentile;
+  return true;
+}
+
 template <int32_t key_len, typename T>
 void TestBase<key_len, T>::testHeavyHitter(
     std::unique_ptr<Sketch::SketchBase<key_len, T>> &ptr_sketch,
@@ -803,6 +1029,248 @@ void TestBase<key_len, T>::testDecode(
   }
 }
 
+template <int32_t key_len, typename T>
+void TestBase<key_len, T>::testEpoch(
+    std::vector<std::unique_ptr<Sketch::SketchBase<key_len, T>>> ptr_sketches,
+    typename std::vector<Data::Record<key_len>>::const_iterator begin,
+    typename std::vector<Data::Record<key_len>>::const_iterator end,
+    Data::CntMethod cnt_method, int64_t window, int64_t slide) {
+  // config
+  MetricVec metric_vec(config_file, test_path, "epoch");
+
+  if (window <= 0 || slide <= 0 || window % slide) {
+    throw std::invalid_argument(
+        "Invalid Argument: Window should be a positive multiple of slide.");
+  }
+  // # slides per window, i.e., # windows open at a time
+  const int64_t n = window / slide;
+  if (static_cast<int64_t>(ptr_sketches.size()) < 3 * n) {
+    throw std::invalid_argument("Invalid Argument: " + std::to_string(3 * n) +
+                                " sketches are needed, but only " +
+                                std::to_string(ptr_sketches.size()) +
+                                " are given.");
+  }
+  using Rotator = Util::EpochRotator<Sketch::SketchBase<key_len, T>>;
+  std::vector<std::unique_ptr<Rotator>> rotators;
+  for (int64_t i = 0; i < n; ++i) {
+    rotators.emplace_back(new Rotator(std::move(ptr_sketches[3 * i]),
+                                      std::move(ptr_sketches[3 * i + 1]),
+                                      std::move(ptr_sketches[3 * i + 2])));
+  }
+  // time spent in updating the sketch of each open window, in nanoseconds
+  // as a slide may take less than a microsecond
+  std::vector<std::chrono::nanoseconds> spent(
+      n, std::chrono::nanoseconds::zero());
+
+  double sum_rate = 0.0, sum_ARE = 0.0, sum_AAE = 0.0;
+  int64_t num_window = 0;
+  // update every open window with slide `k`
+  auto ingest = [&](int64_t k, auto first, auto last) {
+    for (int64_t w = std::max<int64_t>(k - n + 1, 0); w <= k; ++w) {
+      auto &sketch = rotators[w % n]->current();
+      const auto tick = std::chrono::steady_clock::now();
+      for (auto ptr = first; ptr != last; ptr++) {
+        sketch.update(ptr->flowkey,
+                      cnt_method == Data::InLength ? ptr->length : 1);
+      }
+      spent[w % n] += std::chrono::steady_clock::now() - tick;
+    }
+  };
+  // close the window that ends with slide `k`, or the oldest open one if the
+  // trace ends before
+  auto close = [&](int64_t k, const Summary &truth, size_t num_record,
+                   bool is_last) {
+    if (k < n - 1 && !is_last)
+      return;
+    const int64_t w = std::max<int64_t>(k - n + 1, 0);
+    Rotator &rotator = *rotators[w % n];
+    rotator.rotate();
+    const auto [ARE, AAE] = windowError(rotator.last(), truth);
+    const double rate =
+        1.0 * num_record / std::max<int64_t>(spent[w % n].count(), 1) * 1e9;
+    spent[w % n] = std::chrono::nanoseconds::zero();
+    fmt::print("{:>15}: [{:g}, {:g}) s, {:d} records, {:d} flows, "
+               "{:g} Mpac/s, ARE {:g}, AAE {:g}\n",
+               fmt::format("Window {:d}", w), w * slide / 1e6,
+               (w * slide + window) / 1e6, num_record, truth.size(),
+               rate / 1e6, ARE, AAE);
+    sum_rate += rate;
+    sum_ARE += ARE;
+    sum_AAE += AAE;
+    num_window++;
+  };
+  replaySlides(begin, end, cnt_method, slide, n, ingest, close);
+
+  if (num_window) {
+    if (metric_vec.in(Metric::RATE)) {
+      epoch[Metric::RATE] = sum_rate / num_window;
+    }
+    if (metric_vec.in(Metric::ARE)) {
+      epoch[Metric::ARE] = sum_ARE / num_window;
+    }
+    if (metric_vec.in(Metric::AAE)) {
+      epoch[Metric::AAE] = sum_AAE / num_window;
+    }
+  }
+}
+
+template <int32_t key_len, typename T>
+void TestBase<key_len, T>::testSlidingWindow(
+    std::unique_ptr<Sketch::SketchBase<key_len, T>> &ptr_sketch,
+    const std::function<void(int64_t)> &advance,
+    typename std::vector<Data::Record<key_len>>::const_iterator begin,
+    typename std::vector<Data::Record<key_len>>::const_iterator end,
+    Data::CntMethod cnt_method, int64_t window, int64_t slide) {
+  // config
+  MetricVec metric_vec(config_file, test_path, "epoch");
+
+  if (window <= 0 || slide <= 0 || window % slide) {
+    throw std::invalid_argument(
+        "Invalid Argument: Window should be a positive multiple of slide.");
+  }
+  // # slides per window
+  const int64_t n = window / slide;
+  if (begin == end)
+    return;
+  const int64_t origin = begin->timestamp;
+
+  auto spent = std::chrono::nanoseconds::zero();
+  double sum_ARE = 0.0, sum_AAE = 0.0;
+  int64_t num_window = 0;
+  // update the sketch with slide `k`
+  auto ingest = [&](int64_t k, auto first, auto last) {
+    const auto tick = std::chrono::steady_clock::now();
+    for (auto ptr = first; ptr != last; ptr++) {
+      advance(ptr->timestamp);
+      ptr_sketch->update(ptr->flowkey,
+                         cnt_method == Data::InLength ? ptr->length : 1);
+    }
+    spent += std::chrono::steady_clock::now() - tick;
+  };
+  // query the window that ends with slide `k`, which may have no records
+  auto close = [&](int64_t k, const Summary &truth, size_t num_record,
+                   bool is_last) {
+    advance(origin + k * slide);
+    const auto [ARE, AAE] = windowError(*ptr_sketch, truth);
+    fmt::print("{:>15}: [{:g}, {:g}) s, {:d} records, {:d} flows, "
+               "ARE {:g}, AAE {:g}\n",
+               fmt::format("Slide {:d}", k),
+               std::max<int64_t>(k - n + 1, 0) * slide / 1e6,
+               (k + 1) * slide / 1e6, num_record, truth.size(), ARE, AAE);
+    sum_ARE += ARE;
+    sum_AAE += AAE;
+    num_window++;
+  };
+  replaySlides(begin, end, cnt_method, slide, n, ingest, close);
+
+  if (num_window) {
+    if (metric_vec.in(Metric::RATE)) {
+      epoch[Metric::RATE] =
+          1.0 * (end - begin) / std::max<int64_t>(spent.count(), 1) * 1e9;
+    }
+    if (metric_vec.in(Metric::ARE)) {
+      epoch[Metric::ARE] = sum_ARE / num_window;
+    }
+    if (metric_vec.in(Metric::AAE)) {
+      epoch[Metric::AAE] = sum_AAE / num_window;
+    }
+  }
+}
+
+template <int32_t key_len, typename T>
+template <typename ingest_t, typename close_t>
+void TestBase<key_len, T>::replaySlides(
+    typename std::vector<Data::Record<key_len>>::const_iterator begin,
+    typename std::vector<Data::Record<key_len>>::const_iterator end,
+    Data::CntMethod cnt_method, int64_t slide, int64_t num_slide,
+    ingest_t &&ingest, close_t &&close) const {
+  if (begin == end)
+    return;
+  // flows and # records of each slide in the current window
+  std::deque<std::pair<Summary, size_t>> slides;
+  // ground truth of the current window, i.e., the sum over `slides`
+  Summary running;
+  size_t num_record = 0;
+  const int64_t origin = begin->timestamp;
+
+  for (int64_t cur = 0;; ++cur) {
+    // records of the current slide, including late ones
+    auto first = begin, last = begin;
+    Summary summary;
+    while (last != end && (last->timestamp - origin) / slide <= cur) {
+      const T value = cnt_method == Data::InLength ? last->length : 1;
+      summary[last->flowkey] += value;
+      running[last->flowkey] += value;
+      last++;
+    }
+    if (first != last) {
+      ingest(cur, first, last);
+    }
+    slides.emplace_back(std::move(summary), last - first);
+    num_record += last - first;
+    if (!running.empty()) {
+      close(cur, running, num_record, last == end);
+    }
+    if (last == end)
+      break;
+    begin = last;
+    // the oldest slide is no longer in the window
+    if (static_cast<int64_t>(slides.size()) == num_slide) {
+      for (const auto &kv : slides.front().first) {
+        auto iter = running.find(kv.first);
+        iter->second -= kv.second;
+        if (iter->second == 0)
+          running.erase(iter);
+      }
+      num_record -= slides.front().second;
+      slides.pop_front();
+    }
+    if (running.empty()) {
+      // skip a gap in the trace, where the slides in between are empty
+      cur = std::max((begin->timestamp - origin) / slide - 1, cur);
+      slides.clear();
+    }
+  }
+}
+
+template <int32_t key_len, typename T>
+std::pair<double, double>
+TestBase<key_len, T>::windowError(const Sketch::SketchBase<key_len, T> &sketch,
+                                  const Summary &truth) const {
+  std::vector<FlowKey<key_len>> flowkeys;
+  flowkeys.reserve(truth.size());
+  for (const auto &kv : truth) {
+    flowkeys.push_back(kv.first);
+  }
+  std::vector<T> estimated;
+  sketch.queryMany(flowkeys.data(), flowkeys.size(), estimated);
+  double ARE = 0.0, AAE = 0.0;
+  for (size_t i = 0; i < flowkeys.size(); ++i) {
+    const T value = truth.at(flowkeys[i]);
+    ARE += static_cast<double>(std::abs(value - estimated[i])) / value;
+    AAE += std::abs(value - estimated[i]);
+  }
+  return {ARE / flowkeys.size(), AAE / flowkeys.size()};
+}
+
+template <typename base_t, template <int32_t, int32_t> class sketch_t,
+          int32_t D1, int32_t D2, typename make_t>
+std::unique_ptr<base_t> makeFixedSketch(int32_t d1, int32_t d2,
+                                        make_t &&make) {
+  if (D1 > 0 && D2 > 0 && d1 == D1 && Util::NextPrime(d2) == D2) {
+    return make(TypeTag<sketch_t<D1, D2>>(), D2);
+  }
+  static bool warned = false;
+  if ((D1 > 0 || D2 > 0) && !warned) {
+    LOG(WARNING,
+        fmt::format("Dimensions {:d} and {:d} differ from {:d} and {:d} fixed "
+                    "in the driver, and are thus given at runtime.",
+                    d1, d2, D1, D2));
+    warned = true;
+  }
+  return make(TypeTag<sketch_t<0, 0>>(), d2);
+}
+
 #undef DEFINE_TIMERS
 #undef START_TIMER
 #undef STOP_TIMER
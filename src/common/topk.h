@@ -0,0 +1,248 @@
+/**
+ * @file topk.h
+ * @author dromniscience (you@domain.com)
+ * @brief Bounded min-heap for tracking top-k flows
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include "data.h"
+#include "flowkey.h"
+#include <unordered_map>
+#include <vector>
+
+namespace OmniSketch::Sketch {
+/**
+ * @brief Indexed min-heap holding at most `k` flowkeys with the largest
+ * values
+ *
+ * @details Sketches maintain it alongside their counters: after updating a
+ * flowkey, they feed its new estimate to the heap if admits() says so. The
+ * check is a single comparison against the current k-th largest value, so
+ * most updates never touch the heap. The index from flowkeys to heap positions
+ * makes updating a flowkey already in the heap `O(log k)`.
+ *
+ * @tparam key_len  length of flowkey
+ * @tparam T        type of the value
+ */
+template <int32_t key_len, typename T> class TopKHeap {
+public:
+  using Entry = std::pair<FlowKey<key_len>, T>;
+
+private:
+  const size_t capacity;
+  std::vector<Entry> heap;
+  std::unordered_map<FlowKey<key_len>, size_t> index;
+
+  /**
+   * @brief Swap two nodes and fix their indices
+   *
+   */
+  void swapNode(size_t a, size_t b);
+  /**
+   * @brief Move a node towards the root until the heap property holds
+   *
+   */
+  void siftUp(size_t pos);
+  /**
+   * @brief Move a node towards the leaves until the heap property holds
+   *
+   */
+  void siftDown(size_t pos);
+
+public:
+  /**
+   * @brief Construct by specifying the maximum number of flowkeys
+   *
+   */
+  TopKHeap(size_t k);
+  /**
+   * @brief Whether a flowkey with such value should be fed to the heap
+   *
+   * @details `true` if the heap is not full or `val` exceeds the minimum in
+   * the heap.
+   */
+  bool admits(T val) const {
+    return heap.size() < capacity || val > heap.front().second;
+  }
+  /**
+   * @brief Feed the latest value of a flowkey
+   *
+   * @details If the flowkey is in the heap, its value is updated. Otherwise,
+   * it is inserted, evicting the minimum if the heap is full. The caller
+   * should check admits() first.
+   */
+  void update(const FlowKey<key_len> &flowkey, T val);
+  /**
+   * @brief Minimum value in the heap
+   * @details Undefined if the heap is empty.
+   */
+  T min() const { return heap.front().second; }
+  /**
+   * @brief Whether the heap is empty
+   *
+   */
+  bool empty() const { return heap.empty(); }
+  /**
+   * @brief Iterator to the first entry (in no particular order)
+   *
+   */
+  typename std::vector<Entry>::const_iterator begin() const {
+    return heap.cbegin();
+  }
+  /**
+   * @brief Iterator past the last entry
+   *
+   */
+  typename std::vector<Entry>::const_iterator end() const {
+    return heap.cend();
+  }
+  /**
+   * @brief Size of the heap (in bytes)
+   * @details Including the index, estimated as one flowkey and one position
+   * per entry.
+   */
+  size_t size() const {
+    return capacity * (sizeof(Entry) + sizeof(FlowKey<key_len>) +
+                       sizeof(size_t));
+  }
+  /**
+   * @brief Reset the heap
+   *
+   */
+  void clear();
+  /**
+   * @brief Get the flowkeys in the heap whose recorded values are `>=
+   * threshold`
+   * @details The recorded value of a flowkey is its estimate at its last
+   * update. It suits sketches whose estimates never fall as other flowkeys
+   * are updated, e.g., CM and CU: there it is a lower bound of the current
+   * estimate, and no less accurate since they only overestimate.
+   */
+  Data::Estimation<key_len, T> getHeavyHitter(double threshold) const;
+  /**
+   * @brief Get the flowkeys in the heap whose estimates are `>= threshold`
+   * @details Each flowkey is estimated again by `query`, which is usually the
+   * query() of the sketch that maintains the heap. Use it if estimates may
+   * fall after a flowkey is last updated, so that a recorded value can be
+   * too large.
+   */
+  template <typename query_t>
+  Data::Estimation<key_len, T> getHeavyHitter(double threshold,
+                                              const query_t &query) const;
+};
+
+} // namespace OmniSketch::Sketch
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Sketch {
+
+template <int32_t key_len, typename T>
+TopKHeap<key_len, T>::TopKHeap(size_t k) : capacity(k) {
+  if (k == 0) {
+    throw std::invalid_argument(
+        "Invalid Argument: Top-k heap should hold at least 1 flowkey.");
+  }
+  heap.reserve(capacity);
+  index.reserve(capacity);
+}
+
+template <int32_t key_len, typename T>
+void TopKHeap<key_len, T>::swapNode(size_t a, size_t b) {
+  std::swap(heap[a], heap[b]);
+  index[heap[a].first] = a;
+  index[heap[b].first] = b;
+}
+
+template <int32_t key_len, typename T>
+void TopKHeap<key_len, T>::siftUp(size_t pos) {
+  while (pos > 0) {
+    size_t parent = (pos - 1) / 2;
+    if (heap[parent].second <= heap[pos].second)
+      break;
+    swapNode(pos, parent);
+    pos = parent;
+  }
+}
+
+template <int32_t key_len, typename T>
+void TopKHeap<key_len, T>::siftDown(size_t pos) {
+  const size_t n = heap.size();
+  while (true) {
+    size_t smallest = pos;
+    size_t left = 2 * pos + 1, right = 2 * pos + 2;
+    if (left < n && heap[left].second < heap[smallest].second)
+      smallest = left;
+    if (right < n && heap[right].second < heap[smallest].second)
+      smallest = right;
+    if (smallest == pos)
+      break;
+    swapNode(pos, smallest);
+    pos = smallest;
+  }
+}
+
+template <int32_t key_len, typename T>
+void TopKHeap<key_len, T>::update(const FlowKey<key_len> &flowkey, T val) {
+  auto it = index.find(flowkey);
+  if (it != index.end()) { // already in the heap
+    size_t pos = it->second;
+    T old_val = heap[pos].second;
+    heap[pos].second = val;
+    if (val < old_val) {
+      siftUp(pos);
+    } else {
+      siftDown(pos);
+    }
+  } else if (heap.size() < capacity) { // insert
+    heap.emplace_back(flowkey, val);
+    index[flowkey] = heap.size() - 1;
+    siftUp(heap.size() - 1);
+  } else if (val > heap.front().second) { // evict the minimum
+    index.erase(heap.front().first);
+    heap.front() = Entry(flowkey, val);
+    index[flowkey] = 0;
+    siftDown(0);
+  }
+}
+
+template <int32_t key_len, typename T> void TopKHeap<key_len, T>::clear() {
+  heap.clear();
+  index.clear();
+}
+
+template <int32_t key_len, typename T>
+Data::Estimation<key_len, T>
+TopKHeap<key_len, T>::getHeavyHitter(double threshold) const {
+  Data::Estimation<key_len, T> heavy_hitters;
+  for (const auto &kv : heap) {
+    if (kv.second >= threshold) {
+      heavy_hitters[kv.first] = kv.second;
+    }
+  }
+  return heavy_hitters;
+}
+
+template <int32_t key_len, typename T>
+template <typename query_t>
+Data::Estimation<key_len, T>
+TopKHeap<key_len, T>::getHeavyHitter(double threshold,
+                                     const query_t &query) const {
+  Data::Estimation<key_len, T> heavy_hitters;
+  for (const auto &kv : heap) {
+    T estimate_val = query(kv.first);
+    if (estimate_val >= threshold) {
+      heavy_hitters[kv.first] = estimate_val;
+    }
+  }
+  return heavy_hitters;
+}
+
+} // namespace OmniSketch::Sketch
@@ -8,6 +8,7 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <string_view>
 #include <toml++/toml.h>
 #include <vector>
@@ -303,6 +304,162 @@ public:
   T getVal() const { return counter; }
 };
 
+/**
+ * @brief Array of integers of any fixed length, packed bit by bit
+ *
+ * @details Length of integers is specified at run-time and integers are laid
+ * out contiguously in 64-bit words, so an array of `n` integers of `bits` bits
+ * takes `n * bits / 8` bytes (plus a word of padding). Like DynamicIntX, the
+ * content of each integer is always interpreted as a *non-negative* value and
+ * an update reports the carry-out. If `bits` divides 64, no integer straddles
+ * two words and a faster path is taken.
+ *
+ * @tparam T  Type of values and carry-outs. This class works with both signed
+ * and unsigned integer.
+ */
+template <typename T> class PackedIntArray {
+private:
+  std::vector<uint64_t> words;
+  size_t num;
+  size_t bits;
+  uint64_t mask;
+  bool aligned;
+
+  /**
+   * @brief Store an integer
+   *
+   */
+  void setVal(size_t index, uint64_t val);
+
+public:
+  /**
+   * @brief Construct by specifying the number and the length of the integers
+   * @details Length is in **bits**. Must be in [1, min(63, 8 * sizeof(T) -
+   * 1)], or an exception would be thrown. All integers are initialized to 0.
+   */
+  PackedIntArray(size_t num, size_t bits);
+  /**
+   * @brief Update an integer by a certain value
+   *
+   * @note The same requirement on `val` as in DynamicIntX::operator+() applies,
+   * i.e., `|val| <= 2^n - 1`, where `n = 8 * sizeof(T) - 2`.
+   *
+   * @return the overflowed value
+   */
+  T add(size_t index, T val);
+  /**
+   * @brief Get the value of an integer
+   *
+   */
+  T getVal(size_t index) const {
+    const size_t pos = index * bits;
+    const size_t off = pos & 63;
+    uint64_t val = words[pos >> 6] >> off;
+    if (!aligned && off + bits > 64) {
+      val |= words[(pos >> 6) + 1] << (64 - off);
+    }
+    return static_cast<T>(val & mask);
+  }
+  /**
+   * @brief Prefetch the word holding an integer
+   *
+   */
+  void prefetch(size_t index) const {
+    __builtin_prefetch(words.data() + ((index * bits) >> 6));
+  }
+  /**
+   * @brief Number of integers
+   *
+   */
+  size_t size() const { return num; }
+  /**
+   * @brief Reset all integers to 0
+   *
+   */
+  void clear() { std::fill(words.begin(), words.end(), 0); }
+};
+
+/**
+ * @brief A bounded buffer that sums up values by index
+ *
+ * @details Distinct indices are kept in the order they first arrive, along
+ * with their accumulated values, and located through an open-addressed table
+ * with linear probing. Memory is fixed at construction and only depends on
+ * `capacity`, not on the range of indices. Clearing costs time linear in the
+ * number of buffered indices.
+ *
+ * @tparam T  Type of values
+ */
+template <typename T> class PendingBuffer {
+private:
+  std::vector<size_t> keys;
+  std::vector<T> vals;
+  /**
+   * @brief 1 + position in `keys`, 0 for an empty slot
+   *
+   */
+  std::vector<uint32_t> slots;
+  size_t capacity;
+  int32_t shift;
+
+  /**
+   * @brief Home slot of an index (Fibonacci hashing)
+   *
+   */
+  size_t home(size_t key) const {
+    return static_cast<size_t>((static_cast<uint64_t>(key) *
+                                UINT64_C(0x9E3779B97F4A7C15)) >>
+                               shift);
+  }
+
+public:
+  /**
+   * @brief Construct by specifying the maximum number of distinct indices
+   * @details The table is kept at most half full. An exception would be thrown
+   * if `capacity` is 0 or does not fit in 31 bits.
+   */
+  explicit PendingBuffer(size_t capacity);
+  /**
+   * @brief Add a value to an index
+   * @details An exception would be thrown if `index` is new and the buffer
+   * already holds `capacity` distinct indices.
+   */
+  void add(size_t index, T val);
+  /**
+   * @brief Number of distinct indices buffered
+   *
+   */
+  size_t size() const { return keys.size(); }
+  /**
+   * @brief Whether the buffer is empty
+   *
+   */
+  bool empty() const { return keys.empty(); }
+  /**
+   * @brief The i-th buffered index, in order of arrival
+   *
+   */
+  size_t key(size_t i) const { return keys[i]; }
+  /**
+   * @brief Accumulated value of the i-th buffered index
+   *
+   */
+  T &val(size_t i) { return vals[i]; }
+  /**
+   * @brief Remove all indices
+   *
+   */
+  void clear();
+  /**
+   * @brief Memory taken by the buffer (in bytes)
+   *
+   */
+  size_t bytes() const {
+    return capacity * (sizeof(size_t) + sizeof(T)) +
+           slots.size() * sizeof(uint32_t);
+  }
+};
+
 } // namespace OmniSketch::Util
 
 //-----------------------------------------------------------------------------
@@ -362,4 +519,124 @@ template <typename T> T DynamicIntX<T>::operator+(T val) {
   }
 }
 
+template <typename T>
+PackedIntArray<T>::PackedIntArray(size_t num, size_t bits)
+    : num(num), bits(bits) {
+  const size_t max_bits = std::min<size_t>(63, sizeof(T) * 8 - 1);
+  if (!bits || bits > max_bits) {
+    throw std::length_error(std::string("Length Too Large: Type ") +
+                            typeid(T).name() + " expects size > 0 && <= " +
+                            std::to_string(max_bits) + ", but got " +
+                            std::to_string(bits) + " instead.");
+  }
+  mask = (static_cast<uint64_t>(1) << bits) - 1;
+  aligned = (64 % bits == 0);
+  // one more word so that reading a straddling integer never goes out of range
+  words.resize((num * bits + 63) / 64 + 1, 0);
+}
+
+template <typename T>
+void PackedIntArray<T>::setVal(size_t index, uint64_t val) {
+  const size_t pos = index * bits;
+  const size_t off = pos & 63;
+  uint64_t &lo = words[pos >> 6];
+  lo = (lo & ~(mask << off)) | (val << off);
+  if (!aligned && off + bits > 64) {
+    uint64_t &hi = words[(pos >> 6) + 1];
+    const size_t spill = off + bits - 64;
+    const uint64_t hi_mask = (static_cast<uint64_t>(1) << spill) - 1;
+    hi = (hi & ~hi_mask) | (val >> (64 - off));
+  }
+}
+
+template <typename T> T PackedIntArray<T>::add(size_t index, T val) {
+  constexpr T bound = (static_cast<T>(1) << (sizeof(T) * 8 - 2)) - 1;
+  const uint64_t counter = static_cast<uint64_t>(getVal(index));
+
+  // non-negative update
+  if (val >= static_cast<T>(0)) {
+    // detect overflow
+    if (val > bound) {
+      throw std::overflow_error(
+          "Overflow: The value being updated is too large. Expected <= 2^" +
+          std::to_string(sizeof(T) * 8 - 2) + " - 1, but got " +
+          std::to_string(val) + " instead.");
+    }
+
+    const uint64_t uval = static_cast<uint64_t>(val);
+    const uint64_t add = counter + (uval & mask); // never wraps
+    setVal(index, add & mask);
+    return static_cast<T>((uval >> bits) + (add >> bits));
+  } // negative update, and T must be signed
+  else {
+    // detect overflow
+    if (val < -bound) {
+      throw std::overflow_error("Overflow: The value being updated is too "
+                                "negative. Expected >= -2^" +
+                                std::to_string(sizeof(T) * 8 - 2) +
+                                " + 1, but got " + std::to_string(val) +
+                                " instead.");
+    }
+
+    const uint64_t negate = static_cast<uint64_t>(-val);
+    // borrow bits
+    const uint64_t borrow = (negate >> bits) + (counter < (negate & mask));
+    setVal(index, (counter - (negate & mask)) & mask);
+    return -static_cast<T>(borrow);
+  }
+}
+
+template <typename T>
+PendingBuffer<T>::PendingBuffer(size_t capacity) : capacity(capacity) {
+  if (!capacity || capacity >= (static_cast<size_t>(1) << 31)) {
+    throw std::invalid_argument(
+        "Invalid Argument: Capacity of a buffer should be in [1, 2^31), but "
+        "got " +
+        std::to_string(capacity) + " instead.");
+  }
+  // at least twice as many slots as indices
+  size_t num_slot = 2;
+  int32_t bits = 1;
+  while (num_slot < 2 * capacity) {
+    num_slot <<= 1;
+    bits++;
+  }
+  shift = 64 - bits;
+  slots.resize(num_slot, 0);
+  keys.reserve(capacity);
+  vals.reserve(capacity);
+}
+
+template <typename T> void PendingBuffer<T>::add(size_t index, T val) {
+  const size_t mask = slots.size() - 1;
+  size_t s = home(index);
+  while (slots[s]) {
+    if (keys[slots[s] - 1] == index) {
+      vals[slots[s] - 1] += val;
+      return;
+    }
+    s = (s + 1) & mask;
+  }
+  if (keys.size() == capacity) {
+    throw std::length_error("Length Too Large: Buffer can hold at most " +
+                            std::to_string(capacity) + " indices.");
+  }
+  keys.push_back(index);
+  vals.push_back(val);
+  slots[s] = static_cast<uint32_t>(keys.size());
+}
+
+template <typename T> void PendingBuffer<T>::clear() {
+  const size_t mask = slots.size() - 1;
+  for (uint32_t i = 0; i < keys.size(); ++i) {
+    // slots before it in the probe sequence may already be emptied
+    size_t s = home(keys[i]);
+    while (slots[s] != i + 1)
+      s = (s + 1) & mask;
+    slots[s] = 0;
+  }
+  keys.clear();
+  vals.clear();
+}
+
 } // namespace OmniSketch::Util
\ No newline at end of file
@@ -6,7 +6,11 @@ def help(name: str):
   print(f"explanation:")
   print(f"  The input file should be XXXTest.h. "
         f"The last three lines of the file should contain the author's name, "
-        f"default config file, and template header for the driver.")
+        f"default config file, and template header for the driver. "
+        f"Placeholders like ${{CM.para.depth}} in the template header are "
+        f"replaced with values in the default config file, and those like "
+        f"${{NextPrime(CM.para.width)}} with the smallest prime not less than "
+        f"the value, as sketches round their widths at runtime.")
   sys.exit(-1)
 
 def extract(line: str, argv):
@@ -23,6 +27,71 @@ def pick(a, b, c, name: str):
     return b[1]
   return c[1]
 
+def next_prime(n: int):
+  def is_prime(n: int):
+    if n < 2:
+      return False
+    i = 2
+    while i * i <= n:
+      if n % i == 0:
+        return False
+      i += 1
+    return True
+  while not is_prime(n):
+    n += 1
+  return n
+
+def load_scalars(path: str):
+  # Only integer and boolean values under plain [table] headers are needed, so
+  # they are read line by line rather than with a TOML library, which Python
+  # ships only since 3.11.
+  scalars, table = {}, ""
+  with open(path, "r") as fp:
+    for line in fp:
+      line = line.strip()
+      header = re.fullmatch(r"\[\s*([A-Za-z0-9_.\s-]+?)\s*\]\s*(#.*)?", line)
+      if header:
+        table = re.sub(r"\s+", "", header.group(1))
+        continue
+      if line.startswith("[["):
+        table = None
+        continue
+      pair = re.fullmatch(r"([A-Za-z0-9_-]+)\s*=\s*"
+                          r"([+-]?[0-9][0-9_]*|true|false)\s*(#.*)?", line)
+      if pair and table is not None:
+        value = pair.group(2)
+        if value in ("true", "false"):
+          value = value == "true"
+        else:
+          value = int(value.replace("_", ""))
+        scalars[f"{table}.{pair.group(1)}" if table else pair.group(1)] = value
+  return scalars
+
+def substitute(template: str, config: str, argv):
+  keys = re.findall(r"\$\{([^}]*)\}", template)
+  if not keys:
+    return template
+  path = config if os.path.isabs(config) else \
+    os.path.join(os.path.dirname(os.path.abspath(__file__)), config)
+  scalars = load_scalars(path)
+  for key in keys:
+    match = re.fullmatch(r"NextPrime\((.*)\)", key)
+    name = match.group(1) if match else key
+    if name not in scalars:
+      print(f"({argv[0]}) {argv[1]}: {name} not found in {config}, or is "
+            f"neither an integer nor a boolean.")
+      sys.exit(-1)
+    node = scalars[name]
+    if match:
+      if isinstance(node, bool):
+        print(f"({argv[0]}) {argv[1]}: {name} should be an integer.")
+        sys.exit(-1)
+      node = next_prime(node)
+    elif isinstance(node, bool):
+      node = "true" if node else "false"
+    template = template.replace("${" + key + "}", str(node))
+  return template
+
 def main(argv):
   file, author, config, template = "", "", "", ""
   has_template = False
@@ -48,7 +117,7 @@ def main(argv):
       sys.exit(-1)
     author = pick(a, b, c, "AUTHOR")
     config = pick(a, b, c, "CONFIG")
-    template = pick(a, b, c, "TEMPLATE")
+    template = substitute(pick(a, b, c, "TEMPLATE"), config, argv)
     if not config.startswith('/'):
       config = "../src/" + config
     file = re.split(r'[\\/]', argv[1])[-1][:-6]
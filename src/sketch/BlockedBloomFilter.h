@@ -0,0 +1,248 @@
+/**
+ * @file BlockedBloomFilter.h
+ * @author dromniscience (you@domain.com)
+ * @brief Cache-line-blocked Bloom Filter
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <common/alloc.h>
+#include <common/hash.h>
+#include <common/sketch.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace OmniSketch::Sketch {
+/**
+ * @brief Blocked Bloom Filter
+ *
+ * @details Each flowkey is hashed once. The lower half of the hash value
+ * selects a 64-byte block (i.e., a cache line) as well as `num_hash`
+ * cyclically consecutive 32-bit words in it, and the upper half is multiplied
+ * by a series of odd salts to pick one bit in each of these words. Hence every
+ * insert or lookup touches exactly one cache line. When compiled with AVX2
+ * (e.g., `-march=native`), the `num_hash` bits are computed, set and tested
+ * with two 256-bit masks.
+ *
+ * Compared with BloomFilter of the same memory, the false positive rate is
+ * slightly higher, since bits of a key are no longer spread over the whole
+ * array.
+ *
+ * @tparam key_len  length of flowkey
+ * @tparam hash_t   hashing class
+ * @tparam alloc_t  allocation policy of the blocks (see alloc.h)
+ */
+template <int32_t key_len, typename hash_t = Hash::AwareHash,
+          typename alloc_t = Util::DefaultAlloc>
+class BlockedBloomFilter : public SketchBase<key_len> {
+private:
+  /**
+   * @brief Number of 32-bit words in a block
+   *
+   */
+  static constexpr int32_t WORDS = 16;
+  /**
+   * @brief A cache line
+   *
+   */
+  struct alignas(64) Block {
+    uint32_t word[WORDS];
+  };
+
+  int32_t nblocks;
+  int32_t num_hash;
+  Block *blocks;
+  hash_t hash_fn;
+  /**
+   * @brief `enable[r][i]` is all-one iff word `i` is chosen when words are
+   * picked from the `r`-th one
+   *
+   */
+  alignas(32) uint32_t enable[WORDS][WORDS];
+
+  BlockedBloomFilter(const BlockedBloomFilter &) = delete;
+  BlockedBloomFilter(BlockedBloomFilter &&) = delete;
+  BlockedBloomFilter &operator=(BlockedBloomFilter) = delete;
+
+  /**
+   * @brief Odd salts that map a 32-bit hash to bit offsets in each word
+   *
+   */
+  alignas(32) static constexpr uint32_t SALT[WORDS] = {
+      0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+      0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U,
+      0x9e3779b1U, 0x85ebca77U, 0xc2b2ae3dU, 0x27d4eb2fU,
+      0x165667b1U, 0xd3a2646dU, 0xfd7046c5U, 0xb55a4f09U};
+  /**
+   * @brief Locate the block of a flowkey
+   *
+   * @param flowkey the flowkey
+   * @param key     the 32-bit hash value used to pick bits inside the block
+   * @param first   the first word chosen in the block
+   * @return pointer to the block
+   */
+  Block *locate(const FlowKey<key_len> &flowkey, uint32_t &key,
+                int32_t &first) const {
+    uint64_t hash_val = hash_fn(flowkey);
+    // decorrelate the two halves (finalizer of MurmurHash3)
+    hash_val ^= hash_val >> 33;
+    hash_val *= 0xff51afd7ed558ccdULL;
+    hash_val ^= hash_val >> 33;
+    key = static_cast<uint32_t>(hash_val >> 32);
+    first = static_cast<int32_t>((hash_val >> 28) & (WORDS - 1));
+    return blocks + (hash_val & 0xFFFFFFF) % nblocks;
+  }
+#if defined(__AVX2__)
+  /**
+   * @brief Bit masks of words `[i, i + 8)` in a block
+   *
+   */
+  __m256i getMask(uint32_t key, int32_t first, int32_t i) const {
+    const __m256i salt =
+        _mm256_load_si256(reinterpret_cast<const __m256i *>(SALT + i));
+    const __m256i lane =
+        _mm256_load_si256(reinterpret_cast<const __m256i *>(enable[first] + i));
+    __m256i shift = _mm256_srli_epi32(
+        _mm256_mullo_epi32(_mm256_set1_epi32(key), salt), 27);
+    return _mm256_and_si256(_mm256_sllv_epi32(_mm256_set1_epi32(1), shift),
+                            lane);
+  }
+#endif
+
+public:
+  /**
+   * @brief Construct by specifying # of bits and # of bits set per key
+   *
+   * @param num_bits  # bits (rounded up to a prime number of 512-bit blocks)
+   * @param num_hash  # bits set per key, should be in [1, 16]
+   */
+  BlockedBloomFilter(int32_t num_bits, int32_t num_hash);
+  /**
+   * @brief Destructor
+   *
+   */
+  ~BlockedBloomFilter();
+
+  /**
+   * @brief Insert a flowkey into the bloom filter
+   * @details An overriding method
+   *
+   */
+  void insert(const FlowKey<key_len> &flowkey) override;
+  /**
+   * @brief Look up a flowkey to see whether it exists
+   * @details An overriding method
+   *
+   */
+  bool lookup(const FlowKey<key_len> &flowkey) const override;
+  /**
+   * @brief Size of the sketch
+   * @details An overriding method
+   */
+  size_t size() const override;
+  /**
+   * @brief Number of bits in the filter
+   * @details A non-overriding method. Useful when comparing with a classic
+   * Bloom Filter of the same memory.
+   */
+  int32_t numBits() const { return nblocks * WORDS * 32; }
+  /**
+   * @brief Reset the Bloom Filter
+   *
+   */
+  void clear() override;
+};
+
+} // namespace OmniSketch::Sketch
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Sketch {
+
+template <int32_t key_len, typename hash_t, typename alloc_t>
+BlockedBloomFilter<key_len, hash_t, alloc_t>::BlockedBloomFilter(
+    int32_t num_bits, int32_t num_hash)
+    : num_hash(num_hash) {
+  if (num_hash < 1 || num_hash > WORDS) {
+    throw std::out_of_range("Out of Range: # bits set per key should be in "
+                            "[1, 16], but got " +
+                            std::to_string(num_hash) + " instead.");
+  }
+  nblocks = Util::NextPrime((num_bits + WORDS * 32 - 1) / (WORDS * 32));
+  for (int32_t r = 0; r < WORDS; ++r) {
+    for (int32_t i = 0; i < WORDS; ++i) {
+      enable[r][i] = ((i - r + WORDS) % WORDS < num_hash) ? 0xFFFFFFFFU : 0U;
+    }
+  }
+  // Allocate memory, zero initialized and aligned to cache lines
+  blocks = alloc_t::template allocate<Block>(nblocks);
+}
+
+template <int32_t key_len, typename hash_t, typename alloc_t>
+BlockedBloomFilter<key_len, hash_t, alloc_t>::~BlockedBloomFilter() {
+  alloc_t::deallocate(blocks, nblocks);
+}
+
+template <int32_t key_len, typename hash_t, typename alloc_t>
+void BlockedBloomFilter<key_len, hash_t, alloc_t>::insert(
+    const FlowKey<key_len> &flowkey) {
+  uint32_t key;
+  int32_t first;
+  Block *block = locate(flowkey, key, first);
+#if defined(__AVX2__)
+  for (int32_t i = 0; i < WORDS; i += 8) {
+    __m256i *word = reinterpret_cast<__m256i *>(block->word + i);
+    _mm256_store_si256(
+        word, _mm256_or_si256(_mm256_load_si256(word), getMask(key, first, i)));
+  }
+#else
+  for (int32_t j = 0, i = first; j < num_hash; ++j, i = (i + 1) % WORDS) {
+    block->word[i] |= 1U << ((key * SALT[i]) >> 27);
+  }
+#endif
+}
+
+template <int32_t key_len, typename hash_t, typename alloc_t>
+bool BlockedBloomFilter<key_len, hash_t, alloc_t>::lookup(
+    const FlowKey<key_len> &flowkey) const {
+  uint32_t key;
+  int32_t first;
+  const Block *block = locate(flowkey, key, first);
+#if defined(__AVX2__)
+  for (int32_t i = 0; i < WORDS; i += 8) {
+    __m256i word =
+        _mm256_load_si256(reinterpret_cast<const __m256i *>(block->word + i));
+    // all bits in the mask are on
+    if (!_mm256_testc_si256(word, getMask(key, first, i)))
+      return false;
+  }
+  return true;
+#else
+  for (int32_t j = 0, i = first; j < num_hash; ++j, i = (i + 1) % WORDS) {
+    if (!(block->word[i] & (1U << ((key * SALT[i]) >> 27))))
+      return false;
+  }
+  return true;
+#endif
+}
+
+template <int32_t key_len, typename hash_t, typename alloc_t>
+size_t BlockedBloomFilter<key_len, hash_t, alloc_t>::size() const {
+  return sizeof(*this)              // Instance
+         + nblocks * sizeof(Block); // blocks
+}
+
+template <int32_t key_len, typename hash_t, typename alloc_t>
+void BlockedBloomFilter<key_len, hash_t, alloc_t>::clear() {
+  std::fill(blocks, blocks + nblocks, Block());
+}
+
+} // namespace OmniSketch::Sketch
@@ -10,6 +10,7 @@
 
 #include <common/hash.h>
 #include <common/sketch.h>
+#include <common/table.h>
 
 #define BYTE(n) ((n) >> 3)
 #define BIT(n) ((n)&7)
@@ -18,41 +19,75 @@ namespace OmniSketch::Sketch {
 /**
  * @brief Bloom Filter
  *
+ * @details If `NumHash` and `NumBits` are positive, they are fixed at compile
+ * time and bits are stored inside the instance. See Util::Table.
+ *
  * @tparam key_len  length of flowkey
  * @tparam hash_t   hashing class
+ * @tparam NumHash  # hash classes known at compile time, 0 if given on
+ * construction
+ * @tparam NumBits  # bits known at compile time, 0 if given on construction
+ * @tparam alloc_t  allocation policy of the bits (see alloc.h)
  */
-template <int32_t key_len, typename hash_t = Hash::AwareHash>
+template <int32_t key_len, typename hash_t = Hash::AwareHash,
+          int32_t NumHash = 0, int32_t NumBits = 0,
+          typename alloc_t = Util::DefaultAlloc>
 class BloomFilter : public SketchBase<key_len> {
 
 private:
+  /**
+   * @brief # flowkeys in flight in lookupMany()
+   *
+   */
+  static constexpr size_t BATCH = 16;
+  /**
+   * @brief Maximum # hash classes given on construction, which bounds the
+   * bit positions kept on stack in lookupMany()
+   *
+   */
+  static constexpr int32_t MAX_HASH = 32;
+
   int32_t nbits;
   int32_t num_hash;
-  int32_t nbytes;
-  uint8_t *arr;
+  Util::Table<uint8_t, 1, (NumBits + 7) / 8, alloc_t> arr;
   hash_t *hash_fns;
 
   BloomFilter(const BloomFilter &) = delete;
   BloomFilter(BloomFilter &&) = delete;
   BloomFilter &operator=(BloomFilter) = delete;
 
+  /**
+   * @brief # bits, a constant if `NumBits` is positive
+   *
+   */
+  int32_t bits() const { return NumBits > 0 ? NumBits : nbits; }
+  /**
+   * @brief # hash classes, a constant if `NumHash` is positive
+   *
+   */
+  int32_t hashes() const { return NumHash > 0 ? NumHash : num_hash; }
   /**
    * @brief Set a bit
    *
    */
-  void setBit(int32_t pos) { arr[BYTE(pos)] |= (1 << BIT(pos)); }
+  void setBit(int32_t pos) { arr.data()[BYTE(pos)] |= (1 << BIT(pos)); }
   /**
    * @brief Fetch a bit
    *
    * @return `true` if it is `1`; `false` otherwise.
    */
-  bool getBit(int32_t pos) const { return (arr[BYTE(pos)] >> BIT(pos)) & 1; }
+  bool getBit(int32_t pos) const {
+    return (arr.data()[BYTE(pos)] >> BIT(pos)) & 1;
+  }
 
 public:
   /**
    * @brief Construct by specifying # of bits and hash classes
    *
-   * @param num_bits        # bit
-   * @param num_hash_class  # hash classes
+   * @param num_bits        # bit (rounded up to a prime), should equal
+   * `NumBits` if it is positive (used as is)
+   * @param num_hash_class  # hash classes, should equal `NumHash` if it is
+   * positive, otherwise at most `MAX_HASH`
    */
   BloomFilter(int32_t num_bits, int32_t num_hash_class);
   /**
@@ -73,6 +108,24 @@ public:
    *
    */
   bool lookup(const FlowKey<key_len> &flowkey) const override;
+  /**
+   * @brief Look up a batch of flowkeys
+   * @details An overriding method. Flowkeys are processed in groups of
+   * `BATCH`: bit positions of the whole group are hashed and prefetched first,
+   * and then resolved, so that cache misses of different flowkeys overlap.
+   *
+   */
+  void lookupMany(const FlowKey<key_len> *flowkeys, size_t num,
+                  boost::dynamic_bitset<> &result) const override;
+  /**
+   * @brief Insert a flowkey and tell whether it was absent beforehand
+   * @details A non-overriding method. It is a fused version of lookup() and
+   * insert(), so that each bit position is hashed only once.
+   *
+   * @return `true` if the flowkey is new (i.e., lookup() would have returned
+   * `false`); `false` otherwise.
+   */
+  bool insertIfAbsent(const FlowKey<key_len> &flowkey);
   /**
    * @brief Size of the sketch
    * @details An overriding method
@@ -80,9 +133,9 @@ public:
   size_t size() const override;
   /**
    * @brief Reset the Bloom Filter
-   * @details A non-overriding method
+   *
    */
-  void clear();
+  void clear() override;
 };
 
 } // namespace OmniSketch::Sketch
@@ -95,37 +148,54 @@ public:
 
 namespace OmniSketch::Sketch {
 
-template <int32_t key_len, typename hash_t>
-BloomFilter<key_len, hash_t>::BloomFilter(int32_t num_bits,
-                                          int32_t num_hash_class)
-    : nbits(num_bits), num_hash(num_hash_class) {
-  nbits = Util::NextPrime(nbits);
-  nbytes = (nbits + 7) >> 3; // ceil(nbits / 8)
+template <int32_t key_len, typename hash_t, int32_t NumHash, int32_t NumBits,
+          typename alloc_t>
+BloomFilter<key_len, hash_t, NumHash, NumBits, alloc_t>::BloomFilter(
+    int32_t num_bits, int32_t num_hash_class)
+    : nbits(NumBits > 0 ? num_bits : Util::NextPrime(num_bits)),
+      num_hash(num_hash_class),
+      arr(1, (nbits + 7) >> 3) { // ceil(nbits / 8), zero initialized
+  if ((NumBits > 0 && nbits != NumBits) ||
+      (NumHash > 0 && num_hash != NumHash)) {
+    throw std::invalid_argument(
+        "Invalid Argument: Bloom Filter should have " +
+        std::to_string(NumBits) + " bits and " + std::to_string(NumHash) +
+        " hash classes as fixed in the template (0 for any), but got " +
+        std::to_string(nbits) + " and " + std::to_string(num_hash) +
+        " instead.");
+  }
+  if (NumHash <= 0 && (num_hash <= 0 || num_hash > MAX_HASH)) {
+    throw std::invalid_argument(
+        "Invalid Argument: # hash classes should be in [1, " +
+        std::to_string(MAX_HASH) + "], but got " + std::to_string(num_hash) +
+        " instead.");
+  }
   hash_fns = new hash_t[num_hash];
-  // Allocate memory, zero initialized
-  arr = new uint8_t[nbytes]();
 }
 
-template <int32_t key_len, typename hash_t>
-BloomFilter<key_len, hash_t>::~BloomFilter() {
+template <int32_t key_len, typename hash_t, int32_t NumHash, int32_t NumBits,
+          typename alloc_t>
+BloomFilter<key_len, hash_t, NumHash, NumBits, alloc_t>::~BloomFilter() {
   delete[] hash_fns;
-  delete[] arr;
 }
 
-template <int32_t key_len, typename hash_t>
-void BloomFilter<key_len, hash_t>::insert(const FlowKey<key_len> &flowkey) {
-  for (int32_t i = 0; i < num_hash; ++i) {
-    int32_t idx = hash_fns[i](flowkey) % nbits;
+template <int32_t key_len, typename hash_t, int32_t NumHash, int32_t NumBits,
+          typename alloc_t>
+void BloomFilter<key_len, hash_t, NumHash, NumBits, alloc_t>::insert(
+    const FlowKey<key_len> &flowkey) {
+  for (int32_t i = 0; i < hashes(); ++i) {
+    int32_t idx = hash_fns[i](flowkey) % bits();
     setBit(idx);
   }
 }
 
-template <int32_t key_len, typename hash_t>
-bool BloomFilter<key_len, hash_t>::lookup(
+template <int32_t key_len, typename hash_t, int32_t NumHash, int32_t NumBits,
+          typename alloc_t>
+bool BloomFilter<key_len, hash_t, NumHash, NumBits, alloc_t>::lookup(
     const FlowKey<key_len> &flowkey) const {
   // If every bit is on, return true
-  for (int32_t i = 0; i < num_hash; ++i) {
-    int32_t idx = hash_fns[i](flowkey) % nbits;
+  for (int32_t i = 0; i < hashes(); ++i) {
+    int32_t idx = hash_fns[i](flowkey) % bits();
     if (!getBit(idx)) {
       return false;
     }
@@ -133,16 +203,61 @@ bool BloomFilter<key_len, hash_t>::lookup(
   return true;
 }
 
-template <int32_t key_len, typename hash_t>
-size_t BloomFilter<key_len, hash_t>::size() const {
+template <int32_t key_len, typename hash_t, int32_t NumHash, int32_t NumBits,
+          typename alloc_t>
+void BloomFilter<key_len, hash_t, NumHash, NumBits, alloc_t>::lookupMany(
+    const FlowKey<key_len> *flowkeys, size_t num,
+    boost::dynamic_bitset<> &result) const {
+  result.resize(num);
+  int32_t idx[BATCH * (NumHash > 0 ? NumHash : MAX_HASH)];
+  for (size_t base = 0; base < num; base += BATCH) {
+    const size_t cnt = std::min(BATCH, num - base);
+    // stage 1: hash and prefetch
+    for (size_t k = 0; k < cnt; ++k) {
+      int32_t *pos = idx + k * hashes();
+      for (int32_t i = 0; i < hashes(); ++i) {
+        pos[i] = hash_fns[i](flowkeys[base + k]) % bits();
+        __builtin_prefetch(arr.data() + BYTE(pos[i]));
+      }
+    }
+    // stage 2: resolve
+    for (size_t k = 0; k < cnt; ++k) {
+      const int32_t *pos = idx + k * hashes();
+      bool existed = true;
+      for (int32_t i = 0; i < hashes() && existed; ++i) {
+        existed = getBit(pos[i]);
+      }
+      result[base + k] = existed;
+    }
+  }
+}
+
+template <int32_t key_len, typename hash_t, int32_t NumHash, int32_t NumBits,
+          typename alloc_t>
+bool BloomFilter<key_len, hash_t, NumHash, NumBits, alloc_t>::insertIfAbsent(
+    const FlowKey<key_len> &flowkey) {
+  // test and set in a single pass
+  bool absent = false;
+  for (int32_t i = 0; i < hashes(); ++i) {
+    int32_t idx = hash_fns[i](flowkey) % bits();
+    absent |= !getBit(idx);
+    setBit(idx);
+  }
+  return absent;
+}
+
+template <int32_t key_len, typename hash_t, int32_t NumHash, int32_t NumBits,
+          typename alloc_t>
+size_t BloomFilter<key_len, hash_t, NumHash, NumBits, alloc_t>::size() const {
   return sizeof(*this)                // Instance
-         + nbytes * sizeof(uint8_t)   // arr
-         + num_hash * sizeof(hash_t); // hash_fns
+         + arr.size()                 // arr
+         + hashes() * sizeof(hash_t); // hash_fns
 }
 
-template <int32_t key_len, typename hash_t>
-void BloomFilter<key_len, hash_t>::clear() {
-  std::fill(arr, arr + nbytes, 0);
+template <int32_t key_len, typename hash_t, int32_t NumHash, int32_t NumBits,
+          typename alloc_t>
+void BloomFilter<key_len, hash_t, NumHash, NumBits, alloc_t>::clear() {
+  arr.clear();
 }
 
 } // namespace OmniSketch::Sketch
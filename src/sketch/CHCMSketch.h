@@ -68,6 +68,14 @@ public:
    *
    */
   T query(const FlowKey<key_len> &flowkey) const override;
+  /**
+   * @brief Query a batch of flowkeys
+   * @details An overriding method. CH is flushed and decoded only once for
+   * the whole batch.
+   *
+   */
+  void queryMany(const FlowKey<key_len> *flowkeys, size_t num,
+                 std::vector<T> &result) const override;
   /**
    * @brief Get the size of the sketch
    *
@@ -77,7 +85,22 @@ public:
    * @brief Reset the sketch
    *
    */
-  void clear();
+  void clear() override;
+  /**
+   * @brief Choose the solver for decoding CH
+   * @details A non-overriding method. See CounterHierarchy::setSolver().
+   *
+   */
+  void setSolver(DecodeSolver solver, size_t qr_threshold = 0) {
+    ch->setSolver(solver, qr_threshold);
+  }
+  /**
+   * @brief Decode CH from scratch
+   * @details A non-overriding method. See CounterHierarchy::redecode().
+   *
+   * @return time spent on decoding each layer of CH (in seconds)
+   */
+  std::vector<double> redecode() { return ch->redecode(); }
 };
 
 } // namespace OmniSketch::Sketch
@@ -118,7 +141,7 @@ CHCMSketch<key_len, no_layer, T, hash_t>::CHCMSketch(
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 CHCMSketch<key_len, no_layer, T, hash_t>::~CHCMSketch() {
   delete[] hash_fns;
-  delete[] ch;
+  delete ch;
 }
 
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
@@ -141,6 +164,31 @@ T CHCMSketch<key_len, no_layer, T, hash_t>::query(
   return min_val;
 }
 
+template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
+void CHCMSketch<key_len, no_layer, T, hash_t>::queryMany(
+    const FlowKey<key_len> *flowkeys, size_t num,
+    std::vector<T> &result) const {
+  // serialized indices of all counters involved
+  std::vector<size_t> index(num * depth);
+  for (size_t k = 0; k < num; ++k) {
+    for (int32_t i = 0; i < depth; ++i) {
+      index[k * depth + i] =
+          static_cast<size_t>(i) * width + hash_fns[i](flowkeys[k]) % width;
+    }
+  }
+  std::vector<T> cnt(index.size());
+  ch->getCntMany(index.data(), index.size(), cnt.data());
+
+  result.resize(num);
+  for (size_t k = 0; k < num; ++k) {
+    T min_val = std::numeric_limits<T>::max();
+    for (int32_t i = 0; i < depth; ++i) {
+      min_val = std::min(min_val, cnt[k * depth + i]);
+    }
+    result[k] = min_val;
+  }
+}
+
 template <int32_t key_len, int32_t no_layer, typename T, typename hash_t>
 size_t CHCMSketch<key_len, no_layer, T, hash_t>::size() const {
   return sizeof(*this)            // instance
@@ -8,24 +8,37 @@
  */
 #pragma once
 
+#include <common/counter.h>
 #include <common/hash.h>
 #include <common/sketch.h>
+#include <common/topk.h>
 
 namespace OmniSketch::Sketch {
 /**
  * @brief Count Min Sketch
  *
+ * @details If `Depth` and `Width` are positive, the dimensions are fixed at
+ * compile time and counters are stored inside the instance. See Util::Table.
+ * If `cell_t` is narrower than `T`, e.g., `uint8_t`, each counter takes a
+ * saturating cell of that type and only large counters escalate to `T`, so
+ * several times more counters fit in the same memory. See Util::CounterTable.
+ *
  * @tparam key_len  length of flowkey
  * @tparam T        type of the counter
  * @tparam hash_t   hashing class
+ * @tparam Depth    depth known at compile time, 0 if given on construction
+ * @tparam Width    width known at compile time, 0 if given on construction
+ * @tparam cell_t   type of the cell holding a counter
+ * @tparam alloc_t  allocation policy of the counters (see alloc.h)
  */
-template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash>
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash,
+          int32_t Depth = 0, int32_t Width = 0, typename cell_t = T,
+          typename alloc_t = Util::DefaultAlloc>
 class CMSketch : public SketchBase<key_len, T> {
 private:
-  int32_t depth;
-  int32_t width;
+  Util::CounterTable<T, cell_t, Depth, Width, alloc_t> counter;
   hash_t *hash_fns;
-  T **counter;
+  TopKHeap<key_len, T> *heap;
 
   CMSketch(const CMSketch &) = delete;
   CMSketch(CMSketch &&) = delete;
@@ -34,8 +47,13 @@ public:
   /**
    * @brief Construct by specifying depth and width
    *
+   * @param depth_  depth of the sketch, should equal `Depth` if it is positive
+   * @param width_  width of the sketch (rounded up to a prime), should equal
+   * `Width` if it is positive (used as is)
+   * @param topk_   if positive, the `topk_` flowkeys with the largest
+   * estimates are tracked during update() for getHeavyHitter()
    */
-  CMSketch(int32_t depth_, int32_t width_);
+  CMSketch(int32_t depth_, int32_t width_, int32_t topk_ = 0);
   /**
    * @brief Release the pointer
    *
@@ -46,11 +64,30 @@ public:
    *
    */
   void update(const FlowKey<key_len> &flowkey, T val) override;
+  /**
+   * @brief Update a single row with certain value
+   * @details A non-overriding method for samplers such as NitroSketch, which
+   * scale `val` themselves. Top-k flowkeys are not tracked.
+   *
+   */
+  void updateRow(int32_t row, const FlowKey<key_len> &flowkey, T val);
+  /**
+   * @brief Depth of the sketch
+   *
+   */
+  int32_t getDepth() const { return counter.rows(); }
   /**
    * @brief Query a flowkey
    *
    */
   T query(const FlowKey<key_len> &flowkey) const override;
+  /**
+   * @brief Get the heavy hitters among the tracked top-k flowkeys
+   * @details An overriding method. Only available if `topk_` is positive on
+   * construction; otherwise, an empty estimation is returned.
+   *
+   */
+  Data::Estimation<key_len, T> getHeavyHitter(double threshold) const override;
   /**
    * @brief Get the size of the sketch
    *
@@ -60,7 +97,7 @@ public:
    * @brief Reset the sketch
    *
    */
-  void clear();
+  void clear() override;
 };
 
 } // namespace OmniSketch::Sketch
@@ -73,55 +110,83 @@ public:
 
 namespace OmniSketch::Sketch {
 
-template <int32_t key_len, typename T, typename hash_t>
-CMSketch<key_len, T, hash_t>::CMSketch(int32_t depth_, int32_t width_)
-    : depth(depth_), width(Util::NextPrime(width_)) {
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, typename cell_t, typename alloc_t>
+CMSketch<key_len, T, hash_t, Depth, Width, cell_t, alloc_t>::CMSketch(
+    int32_t depth_, int32_t width_, int32_t topk_)
+    : counter(depth_, Width > 0 ? width_ : Util::NextPrime(width_)),
+      hash_fns(new hash_t[depth_]),
+      heap(topk_ > 0 ? new TopKHeap<key_len, T>(topk_) : nullptr) {}
 
-  hash_fns = new hash_t[depth];
-  // Allocate continuous memory
-  counter = new T *[depth];
-  counter[0] = new T[depth * width](); // Init with zero
-  for (int32_t i = 1; i < depth; ++i) {
-    counter[i] = counter[i - 1] + width;
-  }
-}
-
-template <int32_t key_len, typename T, typename hash_t>
-CMSketch<key_len, T, hash_t>::~CMSketch() {
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, typename cell_t, typename alloc_t>
+CMSketch<key_len, T, hash_t, Depth, Width, cell_t, alloc_t>::~CMSketch() {
   delete[] hash_fns;
-  delete[] counter[0];
-  delete[] counter;
+  if (heap)
+    delete heap;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void CMSketch<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey,
-                                          T val) {
-  for (int32_t i = 0; i < depth; ++i) {
-    int32_t index = hash_fns[i](flowkey) % width;
-    counter[i][index] += val;
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, typename cell_t, typename alloc_t>
+void CMSketch<key_len, T, hash_t, Depth, Width, cell_t, alloc_t>::update(
+    const FlowKey<key_len> &flowkey, T val) {
+  T min_val = std::numeric_limits<T>::max();
+  for (int32_t i = 0; i < counter.rows(); ++i) {
+    int32_t index = hash_fns[i](flowkey) % counter.cols();
+    min_val = std::min(min_val, counter.add(counter.offset(i, index), val));
+  }
+  // track top-k
+  if (heap && heap->admits(min_val)) {
+    heap->update(flowkey, min_val);
   }
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-T CMSketch<key_len, T, hash_t>::query(const FlowKey<key_len> &flowkey) const {
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, typename cell_t, typename alloc_t>
+void CMSketch<key_len, T, hash_t, Depth, Width, cell_t, alloc_t>::updateRow(
+    int32_t row, const FlowKey<key_len> &flowkey, T val) {
+  int32_t index = hash_fns[row](flowkey) % counter.cols();
+  counter.add(counter.offset(row, index), val);
+}
+
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, typename cell_t, typename alloc_t>
+T CMSketch<key_len, T, hash_t, Depth, Width, cell_t, alloc_t>::query(
+    const FlowKey<key_len> &flowkey) const {
   T min_val = std::numeric_limits<T>::max();
-  for (int32_t i = 0; i < depth; ++i) {
-    int32_t index = hash_fns[i](flowkey) % width;
-    min_val = std::min(min_val, counter[i][index]);
+  for (int32_t i = 0; i < counter.rows(); ++i) {
+    int32_t index = hash_fns[i](flowkey) % counter.cols();
+    min_val = std::min(min_val, counter.get(counter.offset(i, index)));
   }
   return min_val;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-size_t CMSketch<key_len, T, hash_t>::size() const {
-  return sizeof(*this)                // instance
-         + sizeof(hash_t) * depth     // hashing class
-         + sizeof(T) * depth * width; // counter
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, typename cell_t, typename alloc_t>
+Data::Estimation<key_len, T>
+CMSketch<key_len, T, hash_t, Depth, Width, cell_t, alloc_t>::getHeavyHitter(
+    double threshold) const {
+  if (!heap)
+    return {};
+  return heap->getHeavyHitter(threshold);
+}
+
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, typename cell_t, typename alloc_t>
+size_t
+CMSketch<key_len, T, hash_t, Depth, Width, cell_t, alloc_t>::size() const {
+  return sizeof(*this)                     // instance
+         + sizeof(hash_t) * counter.rows() // hashing class
+         + counter.size()                  // counter
+         + (heap ? heap->size() : 0);      // top-k heap
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void CMSketch<key_len, T, hash_t>::clear() {
-  std::fill(counter[0], counter[0] + depth * width, 0);
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, typename cell_t, typename alloc_t>
+void CMSketch<key_len, T, hash_t, Depth, Width, cell_t, alloc_t>::clear() {
+  counter.clear();
+  if (heap)
+    heap->clear();
 }
 
 } // namespace OmniSketch::Sketch
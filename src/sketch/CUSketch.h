@@ -9,34 +9,99 @@
  */
 #pragma once
 
+#include <common/counter.h>
 #include <common/hash.h>
 #include <common/sketch.h>
+#include <common/topk.h>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 namespace OmniSketch::Sketch {
 /**
  * @brief CU Sketch
  *
- * @tparam key_len  length of flowkey
- * @tparam T        type of the counter
- * @tparam hash_t   hashing class
+ * @details If `Depth` is positive, the depth is fixed at compile time so that
+ * loops over rows unroll fully. If `Width` is positive as well, counters are
+ * stored inside the instance (see Util::Table). If `Vectorize` is also set,
+ * and when compiled with AVX2 (e.g., `-march=native`), `T` is a 32-bit
+ * integer and `Depth <= 8`, update() gathers the `Depth` counters into one
+ * 256-bit register, takes the horizontal minimum, and writes back only the
+ * counters that have to grow. Whether it pays off depends on the latency of
+ * gathers on the machine, so measure it with the driver before turning it on.
+ * If `cell_t` is narrower than `T`, counters are kept in saturating cells of
+ * that type and escalate to `T` only when large (see Util::CounterTable), in
+ * which case update() is never vectorized.
+ *
+ * @tparam key_len    length of flowkey
+ * @tparam T          type of the counter
+ * @tparam hash_t     hashing class
+ * @tparam Depth      depth known at compile time, 0 if given on construction
+ * @tparam Width      width known at compile time, 0 if given on construction
+ * @tparam Vectorize  whether to update with AVX2 if possible
+ * @tparam cell_t     type of the cell holding a counter
+ * @tparam alloc_t    allocation policy of the counters (see alloc.h)
  */
-template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash>
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash,
+          int32_t Depth = 0, int32_t Width = 0, bool Vectorize = false,
+          typename cell_t = T, typename alloc_t = Util::DefaultAlloc>
 class CUSketch : public SketchBase<key_len, T> {
 private:
-  int32_t depth;
-  int32_t width;
+  /**
+   * @brief Whether the AVX2 path of update() is taken
+   *
+   */
+#if defined(__AVX2__)
+  static constexpr bool SIMD = Vectorize && Depth > 0 && Depth <= 8 &&
+                               std::is_integral_v<T> && sizeof(T) == 4 &&
+                               std::is_same_v<T, cell_t>;
+#else
+  static constexpr bool SIMD = false;
+#endif
+  /**
+   * @brief Maximum depth, which bounds the offsets kept on stack in update()
+   *
+   */
+  static constexpr int32_t MAX_DEPTH = 32;
+  static_assert(Depth <= MAX_DEPTH, "Depth should not exceed MAX_DEPTH");
+  /**
+   * @brief Validate the depth before the counters are allocated
+   *
+   */
+  static int32_t checkDepth(int32_t depth) {
+    if (depth <= 0 || depth > MAX_DEPTH) {
+      throw std::invalid_argument(
+          "Invalid Argument: Depth of CU should be in [1, " +
+          std::to_string(MAX_DEPTH) + "], got " + std::to_string(depth) + ".");
+    }
+    return depth;
+  }
+  Util::CounterTable<T, cell_t, Depth, Width, alloc_t> counter;
   hash_t *hash_fns;
-  T **counter;
+  TopKHeap<key_len, T> *heap;
 
   CUSketch(const CUSketch &) = delete;
   CUSketch(CUSketch &&) = delete;
+  /**
+   * @brief update() with the depth fixed at compile time
+   * @return the estimate after update
+   */
+  T updateFixed(const FlowKey<key_len> &flowkey, T val);
 
 public:
   /**
    * @brief Construct by specifying depth and width
    *
+   * @param depth_  depth of the sketch, at most `MAX_DEPTH`, should equal
+   * `Depth` if it is positive
+   * @param width_  width of the sketch (rounded up to a prime), should equal
+   * `Width` if it is positive (used as is)
+   * @param topk_   if positive, the `topk_` flowkeys with the largest
+   * estimates are tracked during update() for getHeavyHitter()
    */
-  CUSketch(int32_t depth_, int32_t width_);
+  CUSketch(int32_t depth_, int32_t width_, int32_t topk_ = 0);
   /**
    * @brief Release the pointer
    *
@@ -52,6 +117,13 @@ public:
    *
    */
   T query(const FlowKey<key_len> &flowkey) const override;
+  /**
+   * @brief Get the heavy hitters among the tracked top-k flowkeys
+   * @details An overriding method. Only available if `topk_` is positive on
+   * construction; otherwise, an empty estimation is returned.
+   *
+   */
+  Data::Estimation<key_len, T> getHeavyHitter(double threshold) const override;
   /**
    * @brief Get the size of the sketch
    *
@@ -61,7 +133,7 @@ public:
    * @brief Reset the sketch
    *
    */
-  void clear();
+  void clear() override;
 };
 
 } // namespace OmniSketch::Sketch
@@ -73,61 +145,156 @@ public:
 //-----------------------------------------------------------------------------
 
 namespace OmniSketch::Sketch {
-template <int32_t key_len, typename T, typename hash_t>
-CUSketch<key_len, T, hash_t>::CUSketch(int32_t depth_, int32_t width_)
-    : depth(depth_), width(Util::NextPrime(width_)) {
-  hash_fns = new hash_t[depth];
-  // Allocate continuous memory
-  counter = new T *[depth];
-  counter[0] = new T[depth * width](); // Init with zero
-  for (int32_t i = 1; i < depth; ++i) {
-    counter[i] = counter[i - 1] + width;
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, bool Vectorize, typename cell_t, typename alloc_t>
+CUSketch<key_len, T, hash_t, Depth, Width, Vectorize, cell_t,
+         alloc_t>::CUSketch(int32_t depth_, int32_t width_, int32_t topk_)
+    : counter(checkDepth(depth_), Width > 0 ? width_ : Util::NextPrime(width_)),
+      hash_fns(new hash_t[depth_]),
+      heap(topk_ > 0 ? new TopKHeap<key_len, T>(topk_) : nullptr) {
+  // counters are gathered with 32-bit offsets
+  if (SIMD && counter.numCell() > std::numeric_limits<int32_t>::max()) {
+    throw std::out_of_range("Out of Range: Too many counters for AVX2 "
+                            "update, got " +
+                            std::to_string(counter.numCell()) + ".");
   }
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-CUSketch<key_len, T, hash_t>::~CUSketch() {
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, bool Vectorize, typename cell_t, typename alloc_t>
+CUSketch<key_len, T, hash_t, Depth, Width, Vectorize, cell_t,
+         alloc_t>::~CUSketch() {
   delete[] hash_fns;
-  delete[] counter[0];
-  delete[] counter;
+  if (heap)
+    delete heap;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void CUSketch<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey,
-                                          T val) {
-  int32_t indices[depth];
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, bool Vectorize, typename cell_t, typename alloc_t>
+void CUSketch<key_len, T, hash_t, Depth, Width, Vectorize, cell_t,
+              alloc_t>::update(const FlowKey<key_len> &flowkey, T val) {
+  T min_val;
+  if constexpr (Depth > 0) {
+    min_val = updateFixed(flowkey, val);
+  } else {
+    const int32_t depth = counter.rows();
+    size_t offset[MAX_DEPTH];
+    min_val = std::numeric_limits<T>::max();
+    for (int32_t i = 0; i < depth; ++i) {
+      offset[i] = counter.offset(i, hash_fns[i](flowkey) % counter.cols());
+      min_val = std::min(min_val, counter.get(offset[i]));
+    }
+    min_val += val;
+    for (int32_t i = 0; i < depth; ++i) {
+      counter.raise(offset[i], min_val);
+    }
+  }
+  // track top-k
+  if (heap && heap->admits(min_val)) {
+    heap->update(flowkey, min_val);
+  }
+}
+
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, bool Vectorize, typename cell_t, typename alloc_t>
+T CUSketch<key_len, T, hash_t, Depth, Width, Vectorize, cell_t,
+           alloc_t>::updateFixed(const FlowKey<key_len> &flowkey, T val) {
+  size_t offset[Depth > 0 ? Depth : 1];
+  for (int32_t i = 0; i < Depth; ++i) {
+    offset[i] = counter.offset(i, hash_fns[i](flowkey) % counter.cols());
+  }
+#if defined(__AVX2__)
+  if constexpr (SIMD) {
+    T *base = counter.data();
+    // lanes beyond Depth are disabled and read as the maximum
+    alignas(32) int32_t lane[8] = {};
+    for (int32_t i = 0; i < Depth; ++i) {
+      lane[i] = static_cast<int32_t>(offset[i]);
+    }
+    const __m256i enable = _mm256_cmpgt_epi32(
+        _mm256_set1_epi32(Depth),
+        _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    const __m256i old_val = _mm256_mask_i32gather_epi32(
+        _mm256_set1_epi32(static_cast<int32_t>(
+            std::numeric_limits<T>::max())),
+        reinterpret_cast<const int *>(base),
+        _mm256_load_si256(reinterpret_cast<const __m256i *>(lane)), enable,
+        4);
+    // horizontal minimum
+    auto min_fn = [](__m256i a, __m256i b) {
+      return std::is_signed_v<T> ? _mm256_min_epi32(a, b)
+                                 : _mm256_min_epu32(a, b);
+    };
+    __m256i m = min_fn(old_val, _mm256_permute2x128_si256(old_val, old_val, 1));
+    m = min_fn(m, _mm256_shuffle_epi32(m, 0x4E));
+    m = min_fn(m, _mm256_shuffle_epi32(m, 0xB1));
+    T min_val = static_cast<T>(_mm256_cvtsi256_si32(m)) + val;
+    // counters smaller than the new minimum are raised to it
+    const __m256i new_val = _mm256_set1_epi32(static_cast<int32_t>(min_val));
+    const __m256i max_val = std::is_signed_v<T>
+                                ? _mm256_max_epi32(old_val, new_val)
+                                : _mm256_max_epu32(old_val, new_val);
+    uint32_t grow = ~static_cast<uint32_t>(_mm256_movemask_ps(
+                        _mm256_castsi256_ps(_mm256_cmpeq_epi32(max_val,
+                                                               old_val)))) &
+                    ((1U << Depth) - 1);
+    while (grow) {
+      base[offset[__builtin_ctz(grow)]] = min_val;
+      grow &= grow - 1;
+    }
+    return min_val;
+  }
+#endif
   T min_val = std::numeric_limits<T>::max();
-  for (int32_t i = 0; i < depth; ++i) {
-    int32_t idx = hash_fns[i](flowkey) % width;
-    indices[i] = idx;
-    min_val = std::min(min_val, counter[i][idx]);
+  for (int32_t i = 0; i < Depth; ++i) {
+    min_val = std::min(min_val, counter.get(offset[i]));
   }
   min_val += val;
-  for (int32_t i = 0; i < depth; ++i) {
-    counter[i][indices[i]] = std::max(min_val, counter[i][indices[i]]);
+  for (int32_t i = 0; i < Depth; ++i) {
+    counter.raise(offset[i], min_val);
   }
+  return min_val;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-T CUSketch<key_len, T, hash_t>::query(const FlowKey<key_len> &flowkey) const {
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, bool Vectorize, typename cell_t, typename alloc_t>
+T CUSketch<key_len, T, hash_t, Depth, Width, Vectorize, cell_t, alloc_t>::query(
+    const FlowKey<key_len> &flowkey) const {
   T min_val = std::numeric_limits<T>::max();
-  for (int32_t i = 0; i < depth; ++i) {
-    int32_t index = hash_fns[i](flowkey) % width;
-    min_val = std::min(min_val, counter[i][index]);
+  for (int32_t i = 0; i < counter.rows(); ++i) {
+    int32_t index = hash_fns[i](flowkey) % counter.cols();
+    min_val = std::min(min_val, counter.get(counter.offset(i, index)));
   }
   return min_val;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-size_t CUSketch<key_len, T, hash_t>::size() const {
-  return sizeof(*this)                // instance
-         + sizeof(hash_t) * depth     // hashing class
-         + sizeof(T) * depth * width; // counter
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, bool Vectorize, typename cell_t, typename alloc_t>
+Data::Estimation<key_len, T>
+CUSketch<key_len, T, hash_t, Depth, Width, Vectorize, cell_t,
+         alloc_t>::getHeavyHitter(double threshold) const {
+  if (!heap)
+    return {};
+  return heap->getHeavyHitter(threshold);
+}
+
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, bool Vectorize, typename cell_t, typename alloc_t>
+size_t CUSketch<key_len, T, hash_t, Depth, Width, Vectorize, cell_t,
+                alloc_t>::size() const {
+  return sizeof(*this)                     // instance
+         + sizeof(hash_t) * counter.rows() // hashing class
+         + counter.size()                  // counter
+         + (heap ? heap->size() : 0);      // top-k heap
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void CUSketch<key_len, T, hash_t>::clear() {
-  std::fill(counter[0], counter[0] + depth * width, 0);
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, bool Vectorize, typename cell_t, typename alloc_t>
+void CUSketch<key_len, T, hash_t, Depth, Width, Vectorize, cell_t,
+              alloc_t>::clear() {
+  counter.clear();
+  if (heap)
+    heap->clear();
 }
 
 } // namespace OmniSketch::Sketch
\ No newline at end of file
@@ -0,0 +1,426 @@
+/**
+ * @file ColdFilter.h
+ * @author dromniscience (you@domain.com)
+ * @brief Implementation of Cold Filter
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <common/hash.h>
+#include <common/sketch.h>
+#include <common/table.h>
+#include <common/utils.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace OmniSketch::Sketch {
+/**
+ * @brief Cold Filter, a front-end that keeps mouse flows away from a sketch
+ *
+ * @details Two layers of CU counters absorb the first packets of every flow.
+ * Layer 1 has 4-bit counters, two in a byte, that saturate at `15`. Once all
+ * counters of a flowkey in layer 1 are saturated, the rest goes to layer 2,
+ * whose 16-bit counters saturate at `threshold_2`. Only what overflows both
+ * layers, i.e., the packets of hot flows, reaches the back-end sketch. Since
+ * most flows are small, the back-end sees far fewer updates and collisions,
+ * which makes it faster and more accurate for the same memory.
+ *
+ * Hot updates are aggregated in a buffer of `BUFFER` flowkeys before they are
+ * forwarded. The buffer is searched by 32-bit fingerprints (8 at a time with
+ * AVX2, e.g., `-march=native`) before the filter, so a packet of a buffered
+ * flow costs a hash and a comparison, and skips both layers. When a new hot
+ * flowkey finds the buffer full, all entries are forwarded at once. The buffer
+ * is also flushed before the back-end is read, by query(), queryMany(),
+ * getHeavyHitter() and decode(). Hence these const methods do modify the
+ * back-end (though not any estimate), and should not be called concurrently.
+ *
+ * Estimates from the back-end are offset by `15 + threshold_2`, what the flow
+ * has left in the filter. Flows with estimates below that are only known to
+ * the filter, so they can be queried but never reported as heavy hitters or
+ * decoded.
+ *
+ * @tparam key_len  length of flowkey
+ * @tparam T        type of the counter
+ * @tparam hash_t   hashing class
+ */
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash>
+class ColdFilter : public SketchBase<key_len, T> {
+private:
+  /**
+   * @brief Saturation of a 4-bit counter in layer 1
+   *
+   */
+  static constexpr int32_t THRESHOLD_1 = 15;
+  /**
+   * @brief Maximum depth of each layer
+   *
+   */
+  static constexpr int32_t MAX_DEPTH = 8;
+  /**
+   * @brief # flowkeys in the aggregation buffer, a multiple of 8
+   *
+   */
+  static constexpr int32_t BUFFER = 16;
+
+  const int32_t depth_1, width_1;
+  const int32_t depth_2, width_2;
+  const int32_t threshold_2;
+  // layer 1, where counter `j` of row `i` is integer `i * width_1 + j`
+  Util::PackedIntArray<int32_t> layer_1;
+  Util::Table<uint16_t> layer_2;
+  hash_t *hash_1;
+  hash_t *hash_2;
+  // flushed into by the const query methods
+  mutable std::unique_ptr<SketchBase<key_len, T>> backend;
+
+  // fingerprints of the buffered flowkeys, 0 marking an empty entry
+  alignas(32) mutable uint32_t buf_fp[BUFFER];
+  mutable FlowKey<key_len> buf_key[BUFFER];
+  mutable T buf_val[BUFFER];
+  mutable int32_t buf_num;
+
+  ColdFilter(const ColdFilter &) = delete;
+  ColdFilter(ColdFilter &&) = delete;
+  ColdFilter &operator=(ColdFilter) = delete;
+
+  /**
+   * @brief Validate the depth of a layer before the layer is allocated
+   *
+   */
+  static int32_t checkDepth(int32_t depth) {
+    if (depth <= 0 || depth > MAX_DEPTH) {
+      throw std::invalid_argument(
+          "Invalid Argument: Depth of each layer should be in [1, " +
+          std::to_string(MAX_DEPTH) + "].");
+    }
+    return depth;
+  }
+  /**
+   * @brief Validate the saturation of layer 2
+   *
+   */
+  static int32_t checkThreshold(int32_t threshold) {
+    if (threshold <= 0 || threshold > 65535) {
+      throw std::invalid_argument(
+          "Invalid Argument: Threshold of layer 2 should be in [1, 65535].");
+    }
+    return threshold;
+  }
+  /**
+   * @brief Nonzero fingerprint derived from the hash value of layer 1
+   *
+   */
+  static uint32_t fingerprint(uint64_t hash_val) {
+    uint32_t fp = static_cast<uint32_t>(hash_val >> 32);
+    return fp ? fp : 1;
+  }
+  /**
+   * @brief Estimate of the filter
+   *
+   * @param hot set iff the flowkey has saturated both layers
+   */
+  T queryFilter(const FlowKey<key_len> &flowkey, bool &hot) const;
+  /**
+   * @brief Entry of the flowkey in the buffer, -1 if none
+   *
+   */
+  int32_t find(uint32_t fp, const FlowKey<key_len> &flowkey) const;
+  /**
+   * @brief Forward all buffered updates to the back-end
+   * @details Const, as it leaves every estimate unchanged, but it does modify
+   * the back-end.
+   */
+  void flush() const;
+
+public:
+  /**
+   * @brief Construct by specifying both layers and the back-end
+   *
+   * @param depth_1_      depth of layer 1, at most `MAX_DEPTH`
+   * @param width_1_      width of layer 1 (rounded up to a prime)
+   * @param depth_2_      depth of layer 2, at most `MAX_DEPTH`
+   * @param width_2_      width of layer 2 (rounded up to a prime)
+   * @param threshold_2_  saturation of layer 2, in `(0, 65535]`
+   * @param backend_      the sketch fed with the hot flows, whose ownership is
+   * taken
+   */
+  ColdFilter(int32_t depth_1_, int32_t width_1_, int32_t depth_2_,
+             int32_t width_2_, int32_t threshold_2_,
+             std::unique_ptr<SketchBase<key_len, T>> backend_);
+  /**
+   * @brief Release the pointers
+   *
+   */
+  ~ColdFilter();
+  /**
+   * @brief Update a flowkey with certain positive value
+   *
+   */
+  void update(const FlowKey<key_len> &flowkey, T val) override;
+  /**
+   * @brief Query a flowkey
+   * @details The estimate of the filter, plus that of the back-end if the
+   * flowkey has saturated the filter. In the latter case, the buffer is
+   * flushed to the back-end first.
+   */
+  T query(const FlowKey<key_len> &flowkey) const override;
+  /**
+   * @brief Query a batch of flowkeys
+   * @details Flowkeys that saturate the filter are queried from the back-end
+   * in a single batch, after the buffer is flushed to the back-end.
+   */
+  void queryMany(const FlowKey<key_len> *flowkeys, size_t num,
+                 std::vector<T> &result) const override;
+  /**
+   * @brief Get the heavy hitters of the back-end
+   * @details The buffer is flushed to the back-end first.
+   *
+   * @param threshold A flowkey is a HH iff its estimate `>= threshold`
+   */
+  Data::Estimation<key_len, T> getHeavyHitter(double threshold) const override;
+  /**
+   * @brief Decode the flowkeys of the back-end
+   *
+   */
+  Data::Estimation<key_len, T> decode() override;
+  /**
+   * @brief Get the size of the sketch, including the back-end
+   *
+   */
+  size_t size() const override;
+  /**
+   * @brief Reset the sketch, including the back-end
+   *
+   */
+  void clear() override;
+};
+
+} // namespace OmniSketch::Sketch
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Sketch {
+
+template <int32_t key_len, typename T, typename hash_t>
+ColdFilter<key_len, T, hash_t>::ColdFilter(
+    int32_t depth_1_, int32_t width_1_, int32_t depth_2_, int32_t width_2_,
+    int32_t threshold_2_, std::unique_ptr<SketchBase<key_len, T>> backend_)
+    : depth_1(checkDepth(depth_1_)), width_1(Util::NextPrime(width_1_)),
+      depth_2(checkDepth(depth_2_)), width_2(Util::NextPrime(width_2_)),
+      threshold_2(checkThreshold(threshold_2_)),
+      layer_1(static_cast<size_t>(depth_1) * width_1, 4),
+      layer_2(depth_2, width_2), backend(std::move(backend_)), buf_fp(),
+      buf_num(0) {
+  if (!backend) {
+    throw std::invalid_argument("Invalid Argument: Back-end is missing.");
+  }
+  hash_1 = new hash_t[depth_1];
+  hash_2 = new hash_t[depth_2];
+}
+
+template <int32_t key_len, typename T, typename hash_t>
+ColdFilter<key_len, T, hash_t>::~ColdFilter() {
+  delete[] hash_1;
+  delete[] hash_2;
+}
+
+template <int32_t key_len, typename T, typename hash_t>
+int32_t ColdFilter<key_len, T, hash_t>::find(
+    uint32_t fp, const FlowKey<key_len> &flowkey) const {
+#if defined(__AVX2__)
+  const __m256i target = _mm256_set1_epi32(static_cast<int32_t>(fp));
+  for (int32_t i = 0; i < BUFFER; i += 8) {
+    const __m256i lanes =
+        _mm256_load_si256(reinterpret_cast<const __m256i *>(buf_fp + i));
+    uint32_t match = _mm256_movemask_ps(
+        _mm256_castsi256_ps(_mm256_cmpeq_epi32(lanes, target)));
+    while (match) {
+      const int32_t j = i + __builtin_ctz(match);
+      if (buf_key[j] == flowkey)
+        return j;
+      match &= match - 1;
+    }
+  }
+#else
+  for (int32_t i = 0; i < buf_num; ++i) {
+    if (buf_fp[i] == fp && buf_key[i] == flowkey)
+      return i;
+  }
+#endif
+  return -1;
+}
+
+template <int32_t key_len, typename T, typename hash_t>
+void ColdFilter<key_len, T, hash_t>::flush() const {
+  for (int32_t i = 0; i < buf_num; ++i) {
+    backend->update(buf_key[i], buf_val[i]);
+    buf_fp[i] = 0;
+  }
+  buf_num = 0;
+}
+
+template <int32_t key_len, typename T, typename hash_t>
+void ColdFilter<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey,
+                                            T val) {
+  if (val <= 0)
+    return;
+  // a hot flow in the buffer skips the filter
+  const uint64_t hash_val = hash_1[0](flowkey);
+  const uint32_t fp = fingerprint(hash_val);
+  const int32_t entry = find(fp, flowkey);
+  if (entry >= 0) {
+    buf_val[entry] += val;
+    return;
+  }
+  int32_t index[MAX_DEPTH];
+  // layer 1
+  int32_t min_val = THRESHOLD_1;
+  for (int32_t i = 0; i < depth_1; ++i) {
+    index[i] = i * width_1 + (i ? hash_1[i](flowkey) : hash_val) % width_1;
+    min_val = std::min(min_val, layer_1.getVal(index[i]));
+  }
+  if (min_val < THRESHOLD_1) {
+    const int32_t inc = std::min<T>(val, THRESHOLD_1 - min_val);
+    for (int32_t i = 0; i < depth_1; ++i) {
+      const int32_t cur_val = layer_1.getVal(index[i]);
+      if (cur_val < min_val + inc) {
+        // never carries, as min_val + inc <= THRESHOLD_1
+        layer_1.add(index[i], min_val + inc - cur_val);
+      }
+    }
+    val -= inc;
+    if (val == 0)
+      return;
+  }
+  // layer 2
+  min_val = threshold_2;
+  for (int32_t i = 0; i < depth_2; ++i) {
+    index[i] = hash_2[i](flowkey) % width_2;
+    min_val = std::min<int32_t>(min_val, layer_2[i][index[i]]);
+  }
+  if (min_val < threshold_2) {
+    const int32_t inc = std::min<T>(val, threshold_2 - min_val);
+    for (int32_t i = 0; i < depth_2; ++i) {
+      if (layer_2[i][index[i]] < min_val + inc) {
+        layer_2[i][index[i]] = min_val + inc;
+      }
+    }
+    val -= inc;
+    if (val == 0)
+      return;
+  }
+  // a hot flow
+  if (buf_num == BUFFER) {
+    flush();
+  }
+  buf_fp[buf_num] = fp;
+  buf_key[buf_num] = flowkey;
+  buf_val[buf_num] = val;
+  buf_num++;
+}
+
+template <int32_t key_len, typename T, typename hash_t>
+T ColdFilter<key_len, T, hash_t>::queryFilter(const FlowKey<key_len> &flowkey,
+                                              bool &hot) const {
+  hot = false;
+  int32_t min_val = THRESHOLD_1;
+  for (int32_t i = 0; i < depth_1; ++i) {
+    min_val = std::min(
+        min_val, layer_1.getVal(i * width_1 + hash_1[i](flowkey) % width_1));
+  }
+  if (min_val < THRESHOLD_1)
+    return min_val;
+  min_val = threshold_2;
+  for (int32_t i = 0; i < depth_2; ++i) {
+    min_val =
+        std::min<int32_t>(min_val, layer_2[i][hash_2[i](flowkey) % width_2]);
+  }
+  hot = min_val == threshold_2;
+  return THRESHOLD_1 + min_val;
+}
+
+template <int32_t key_len, typename T, typename hash_t>
+T ColdFilter<key_len, T, hash_t>::query(const FlowKey<key_len> &flowkey) const {
+  bool hot;
+  T estimate_val = queryFilter(flowkey, hot);
+  if (!hot)
+    return estimate_val;
+  flush();
+  return estimate_val + backend->query(flowkey);
+}
+
+template <int32_t key_len, typename T, typename hash_t>
+void ColdFilter<key_len, T, hash_t>::queryMany(
+    const FlowKey<key_len> *flowkeys, size_t num,
+    std::vector<T> &result) const {
+  result.resize(num);
+  std::vector<FlowKey<key_len>> hot_keys;
+  std::vector<size_t> hot_pos;
+  for (size_t k = 0; k < num; ++k) {
+    bool hot;
+    result[k] = queryFilter(flowkeys[k], hot);
+    if (hot) {
+      hot_keys.push_back(flowkeys[k]);
+      hot_pos.push_back(k);
+    }
+  }
+  if (hot_keys.empty())
+    return;
+  flush();
+  std::vector<T> hot_val;
+  backend->queryMany(hot_keys.data(), hot_keys.size(), hot_val);
+  for (size_t k = 0; k < hot_pos.size(); ++k) {
+    result[hot_pos[k]] += hot_val[k];
+  }
+}
+
+template <int32_t key_len, typename T, typename hash_t>
+Data::Estimation<key_len, T>
+ColdFilter<key_len, T, hash_t>::getHeavyHitter(double threshold) const {
+  flush();
+  const T offset = THRESHOLD_1 + threshold_2;
+  Data::Estimation<key_len, T> heavy_hitters;
+  for (const auto &kv : backend->getHeavyHitter(threshold - offset)) {
+    heavy_hitters[kv.get_left()] = kv.get_right() + offset;
+  }
+  return heavy_hitters;
+}
+
+template <int32_t key_len, typename T, typename hash_t>
+Data::Estimation<key_len, T> ColdFilter<key_len, T, hash_t>::decode() {
+  flush();
+  const T offset = THRESHOLD_1 + threshold_2;
+  Data::Estimation<key_len, T> est;
+  for (const auto &kv : backend->decode()) {
+    est[kv.get_left()] = kv.get_right() + offset;
+  }
+  return est;
+}
+
+template <int32_t key_len, typename T, typename hash_t>
+size_t ColdFilter<key_len, T, hash_t>::size() const {
+  return sizeof(*this)                          // instance
+         + sizeof(hash_t) * (depth_1 + depth_2) // hashing class
+         + (layer_1.size() * 4 + 7) / 8         // layer 1
+         + layer_2.size()                       // layer 2
+         + backend->size();                     // back-end
+}
+
+template <int32_t key_len, typename T, typename hash_t>
+void ColdFilter<key_len, T, hash_t>::clear() {
+  layer_1.clear();
+  layer_2.clear();
+  std::fill(buf_fp, buf_fp + BUFFER, 0);
+  buf_num = 0;
+  backend->clear();
+}
+
+} // namespace OmniSketch::Sketch
@@ -10,32 +10,95 @@
 
 #include <common/hash.h>
 #include <common/sketch.h>
+#include <common/table.h>
+#include <common/topk.h>
 
 namespace OmniSketch::Sketch {
 /**
  * @brief Count Sketch
  *
+ * @details Each row is hashed once: the hash value modulo the width picks the
+ * counter, and its most significant bit picks the sign. If `Depth` and `Width`
+ * are positive, the dimensions are fixed at compile time and counters are
+ * stored inside the instance. See Util::Table.
+ *
  * @tparam key_len  length of flowkey
  * @tparam T        type of the counter
  * @tparam hash_t   hashing class
+ * @tparam Depth    depth known at compile time, 0 if given on construction
+ * @tparam Width    width known at compile time, 0 if given on construction
+ * @tparam alloc_t  allocation policy of the counters (see alloc.h)
  */
-template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash>
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash,
+          int32_t Depth = 0, int32_t Width = 0,
+          typename alloc_t = Util::DefaultAlloc>
 class CountSketch : public SketchBase<key_len, T> {
 private:
-  int32_t depth;
-  int32_t width;
+  Util::Table<T, Depth, Width, alloc_t> counter;
   hash_t *hash_fns;
-  T **counter;
+  TopKHeap<key_len, T> *heap;
 
   CountSketch(const CountSketch &) = delete;
   CountSketch(CountSketch &&) = delete;
 
+  /**
+   * @brief # flowkeys hashed ahead in queryMany()
+   *
+   */
+  static constexpr size_t BATCH = 16;
+  /**
+   * @brief Maximum depth, which bounds the arrays kept on stack
+   *
+   */
+  static constexpr int32_t MAX_DEPTH = 32;
+  static_assert(Depth <= MAX_DEPTH, "Depth should not exceed MAX_DEPTH");
+  /**
+   * @brief Validate the depth before the counters are allocated
+   *
+   */
+  static int32_t checkDepth(int32_t depth) {
+    if (depth <= 0 || depth > MAX_DEPTH) {
+      throw std::invalid_argument(
+          "Invalid Argument: Depth of CS should be in [1, " +
+          std::to_string(MAX_DEPTH) + "], got " + std::to_string(depth) + ".");
+    }
+    return depth;
+  }
+  /**
+   * @brief Sign of a flowkey in a row, given its hash value
+   *
+   */
+  static T sign(uint64_t hash_val) {
+    return static_cast<T>(hash_val >> 63) * 2 - 1;
+  }
+  /**
+   * @brief Compare and exchange without branches so that `a <= b` afterwards
+   *
+   */
+  static void sort2(T &a, T &b) {
+    T lo = std::min(a, b);
+    b = std::max(a, b);
+    a = lo;
+  }
+  /**
+   * @brief Estimate by the signed counters of all rows
+   * @details Sorting networks select the median when the depth is 3, 5 or 7.
+   * `values` is reordered in place.
+   */
+  T median(T *values) const;
+
 public:
   /**
    * @brief Construct by specifying depth and width
    *
+   * @param depth_  depth of the sketch, at most `MAX_DEPTH`, should equal
+   * `Depth` if it is positive
+   * @param width_  width of the sketch (rounded up to a prime), should equal
+   * `Width` if it is positive (used as is)
+   * @param topk_   if positive, the `topk_` flowkeys with the largest
+   * estimates are tracked during update() for getHeavyHitter()
    */
-  CountSketch(int32_t depth_, int32_t width_);
+  CountSketch(int32_t depth_, int32_t width_, int32_t topk_ = 0);
   /**
    * @brief Release the pointer
    *
@@ -46,11 +109,38 @@ public:
    *
    */
   void update(const FlowKey<key_len> &flowkey, T val) override;
+  /**
+   * @brief Update a single row with certain value
+   * @details A non-overriding method for samplers such as NitroSketch, which
+   * scale `val` themselves. Top-k flowkeys are not tracked.
+   *
+   */
+  void updateRow(int32_t row, const FlowKey<key_len> &flowkey, T val);
+  /**
+   * @brief Depth of the sketch
+   *
+   */
+  int32_t getDepth() const { return counter.rows(); }
   /**
    * @brief Query a flowkey
    *
    */
   T query(const FlowKey<key_len> &flowkey) const override;
+  /**
+   * @brief Query a batch of flowkeys
+   * @details An overriding method. Flowkeys are hashed and their counters
+   * prefetched in groups before any estimate is taken.
+   *
+   */
+  void queryMany(const FlowKey<key_len> *flowkeys, size_t num,
+                 std::vector<T> &result) const override;
+  /**
+   * @brief Get the heavy hitters among the tracked top-k flowkeys
+   * @details An overriding method. Only available if `topk_` is positive on
+   * construction; otherwise, an empty estimation is returned.
+   *
+   */
+  Data::Estimation<key_len, T> getHeavyHitter(double threshold) const override;
   /**
    * @brief Get the size of the sketch
    *
@@ -60,7 +150,7 @@ public:
    * @brief Reset the sketch
    *
    */
-  void clear();
+  void clear() override;
 };
 
 } // namespace OmniSketch::Sketch
@@ -73,65 +163,177 @@ public:
 
 namespace OmniSketch::Sketch {
 
-template <int32_t key_len, typename T, typename hash_t>
-CountSketch<key_len, T, hash_t>::CountSketch(int32_t depth_, int32_t width_)
-    : depth(depth_), width(Util::NextPrime(width_)) {
-
-  // The first depth hash functions: CM
-  // The last depth hash function: signed bit
-  hash_fns = new hash_t[depth * 2];
-  // Allocate continuous memory
-  counter = new T *[depth];
-  counter[0] = new T[depth * width](); // Init with zero
-  for (int32_t i = 1; i < depth; ++i) {
-    counter[i] = counter[i - 1] + width;
-  }
-}
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, typename alloc_t>
+CountSketch<key_len, T, hash_t, Depth, Width, alloc_t>::CountSketch(
+    int32_t depth_, int32_t width_, int32_t topk_)
+    : counter(checkDepth(depth_), Width > 0 ? width_ : Util::NextPrime(width_)),
+      hash_fns(new hash_t[depth_]),
+      heap(topk_ > 0 ? new TopKHeap<key_len, T>(topk_) : nullptr) {}
 
-template <int32_t key_len, typename T, typename hash_t>
-CountSketch<key_len, T, hash_t>::~CountSketch() {
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, typename alloc_t>
+CountSketch<key_len, T, hash_t, Depth, Width, alloc_t>::~CountSketch() {
   delete[] hash_fns;
-  delete[] counter[0];
-  delete[] counter;
+  if (heap)
+    delete heap;
+}
+
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, typename alloc_t>
+void CountSketch<key_len, T, hash_t, Depth, Width, alloc_t>::update(
+    const FlowKey<key_len> &flowkey, T val) {
+  const int32_t depth = counter.rows(), width = counter.cols();
+  T values[MAX_DEPTH];
+  for (int32_t i = 0; i < depth; ++i) {
+    uint64_t hash_val = hash_fns[i](flowkey);
+    T s = sign(hash_val);
+    T &cnt = counter[i][hash_val % width];
+    cnt += val * s;
+    values[i] = cnt * s;
+  }
+  // track top-k, where the median has to be taken
+  if (heap) {
+    T estimate_val = median(values);
+    if (heap->admits(estimate_val)) {
+      heap->update(flowkey, estimate_val);
+    }
+  }
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void CountSketch<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey,
-                                             T val) {
-  for (int i = 0; i < depth; ++i) {
-    int idx = hash_fns[i](flowkey) % width;
-    counter[i][idx] +=
-        val * (static_cast<int>(hash_fns[depth + i](flowkey) & 1) * 2 - 1);
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, typename alloc_t>
+T CountSketch<key_len, T, hash_t, Depth, Width, alloc_t>::median(
+    T *values) const {
+  const int32_t depth = counter.rows();
+  T ret;
+  switch (depth) {
+  case 1:
+    ret = values[0];
+    break;
+  case 3:
+    sort2(values[0], values[1]);
+    ret = std::max(values[0], std::min(values[1], values[2]));
+    break;
+  case 5:
+    sort2(values[0], values[1]);
+    sort2(values[3], values[4]);
+    sort2(values[0], values[3]);
+    sort2(values[1], values[4]);
+    sort2(values[1], values[2]);
+    sort2(values[2], values[3]);
+    sort2(values[1], values[2]);
+    ret = values[2];
+    break;
+  case 7:
+    sort2(values[0], values[5]);
+    sort2(values[0], values[3]);
+    sort2(values[1], values[6]);
+    sort2(values[2], values[4]);
+    sort2(values[0], values[1]);
+    sort2(values[3], values[5]);
+    sort2(values[2], values[6]);
+    sort2(values[2], values[3]);
+    sort2(values[3], values[6]);
+    sort2(values[4], values[5]);
+    sort2(values[1], values[4]);
+    sort2(values[1], values[3]);
+    sort2(values[3], values[4]);
+    ret = values[3];
+    break;
+  default:
+    std::sort(values, values + depth);
+    if (!(depth & 1)) { // even
+      ret = (values[depth / 2 - 1] + values[depth / 2]) / 2;
+    } else { // odd
+      ret = values[depth / 2];
+    }
   }
+  return std::abs(ret);
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-T CountSketch<key_len, T, hash_t>::query(
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, typename alloc_t>
+void CountSketch<key_len, T, hash_t, Depth, Width, alloc_t>::updateRow(
+    int32_t row, const FlowKey<key_len> &flowkey, T val) {
+  uint64_t hash_val = hash_fns[row](flowkey);
+  counter[row][hash_val % counter.cols()] += val * sign(hash_val);
+}
+
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, typename alloc_t>
+T CountSketch<key_len, T, hash_t, Depth, Width, alloc_t>::query(
     const FlowKey<key_len> &flowkey) const {
-  T values[depth];
-  for (int i = 0; i < depth; ++i) {
-    int idx = hash_fns[i](flowkey) % width;
-    values[i] = counter[i][idx] *
-                (static_cast<int>(hash_fns[depth + i](flowkey) & 1) * 2 - 1);
+  const int32_t depth = counter.rows(), width = counter.cols();
+  T values[MAX_DEPTH];
+  for (int32_t i = 0; i < depth; ++i) {
+    uint64_t hash_val = hash_fns[i](flowkey);
+    values[i] = counter[i][hash_val % width] * sign(hash_val);
   }
-  std::sort(values, values + depth);
-  if (!(depth & 1)) { // even
-    return std::abs((values[depth / 2 - 1] + values[depth / 2]) / 2);
-  } else { // odd
-    return std::abs(values[depth / 2]);
+  return median(values);
+}
+
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, typename alloc_t>
+void CountSketch<key_len, T, hash_t, Depth, Width, alloc_t>::queryMany(
+    const FlowKey<key_len> *flowkeys, size_t num,
+    std::vector<T> &result) const {
+  const int32_t depth = counter.rows(), width = counter.cols();
+  result.resize(num);
+  uint64_t hash_val[BATCH * MAX_DEPTH];
+  T values[MAX_DEPTH];
+  for (size_t base = 0; base < num; base += BATCH) {
+    const size_t cnt = std::min(BATCH, num - base);
+    // stage 1: hash and prefetch
+    for (size_t k = 0; k < cnt; ++k) {
+      uint64_t *hv = hash_val + k * depth;
+      for (int32_t i = 0; i < depth; ++i) {
+        hv[i] = hash_fns[i](flowkeys[base + k]);
+        __builtin_prefetch(counter[i] + hv[i] % width);
+      }
+    }
+    // stage 2: take the medians
+    for (size_t k = 0; k < cnt; ++k) {
+      const uint64_t *hv = hash_val + k * depth;
+      for (int32_t i = 0; i < depth; ++i) {
+        values[i] = counter[i][hv[i] % width] * sign(hv[i]);
+      }
+      result[base + k] = median(values);
+    }
   }
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-size_t CountSketch<key_len, T, hash_t>::size() const {
-  return sizeof(*this)                // instance
-         + sizeof(hash_t) * depth * 2 // hashing class
-         + sizeof(T) * depth * width; // counter
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, typename alloc_t>
+Data::Estimation<key_len, T>
+CountSketch<key_len, T, hash_t, Depth, Width, alloc_t>::getHeavyHitter(
+    double threshold) const {
+  if (!heap)
+    return {};
+  // Unlike CM and CU, a CS estimate can fall when other flowkeys hit the same
+  // counters with the opposite sign, so the values recorded in the heap may
+  // overestimate. Query each flowkey again instead.
+  return heap->getHeavyHitter(
+      threshold, [this](const FlowKey<key_len> &flowkey) {
+        return query(flowkey);
+      });
+}
+
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, typename alloc_t>
+size_t CountSketch<key_len, T, hash_t, Depth, Width, alloc_t>::size() const {
+  return sizeof(*this)                     // instance
+         + sizeof(hash_t) * counter.rows() // hashing class
+         + counter.size()                  // counter
+         + (heap ? heap->size() : 0);      // top-k heap
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void CountSketch<key_len, T, hash_t>::clear() {
-  std::fill(counter[0], counter[0] + depth * width, 0);
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, typename alloc_t>
+void CountSketch<key_len, T, hash_t, Depth, Width, alloc_t>::clear() {
+  counter.clear();
+  if (heap)
+    heap->clear();
 }
 
 } // namespace OmniSketch::Sketch
@@ -8,39 +8,87 @@
  */
 #pragma once
 
+#include <common/alloc.h>
 #include <common/hash.h>
-#include <common/hierarchy.h>
+#include <common/sketch.h>
 
 namespace OmniSketch::Sketch {
 /**
  * @brief Counting Bloom Filter
  *
+ * @details Counters are packed directly into a byte array, either two 4-bit
+ * counters per byte or one 8-bit counter per byte. Counters saturate at their
+ * maximum value and a saturated counter is never decremented, since its true
+ * value is lost.
+ *
  * @tparam key_len  length of flowkey
  * @tparam hash_t   hashing class
+ * @tparam alloc_t  allocation policy of the counters (see alloc.h)
  */
-template <int32_t key_len, typename hash_t = Hash::AwareHash>
+template <int32_t key_len, typename hash_t = Hash::AwareHash,
+          typename alloc_t = Util::DefaultAlloc>
 class CountingBloomFilter : public SketchBase<key_len> {
-  // for convenience
-  using T = int64_t;
-  using CH = CounterHierarchy<1, T, hash_t>;
-
 private:
+  /**
+   * @brief # flowkeys in flight in lookupMany()
+   *
+   */
+  static constexpr size_t BATCH = 16;
+  /**
+   * @brief Maximum # hash, which bounds the indices kept on stack
+   *
+   */
+  static constexpr int32_t MAX_HASH = 32;
+
   int32_t ncnt;
   int32_t nhash;
+  int32_t cnt_len;
+  int32_t nbytes;
+  uint8_t max_cnt;
   hash_t *hash_fns;
-  CH *counter;
+  uint8_t *arr;
 
   CountingBloomFilter(const CountingBloomFilter &) = delete;
   CountingBloomFilter(CountingBloomFilter &&) = delete;
   CountingBloomFilter &operator=(CountingBloomFilter) = delete;
 
+  /**
+   * @brief Byte holding a counter
+   *
+   */
+  int32_t byteOf(int32_t index) const {
+    return cnt_len == 4 ? index >> 1 : index;
+  }
+  /**
+   * @brief Fetch a counter
+   *
+   */
+  uint8_t getCnt(int32_t index) const {
+    if (cnt_len == 4)
+      return (arr[index >> 1] >> ((index & 1) << 2)) & 0xF;
+    return arr[index];
+  }
+  /**
+   * @brief Overwrite a counter
+   *
+   */
+  void setCnt(int32_t index, uint8_t val) {
+    if (cnt_len == 4) {
+      int32_t shift = (index & 1) << 2;
+      arr[index >> 1] =
+          (arr[index >> 1] & ~(0xF << shift)) | ((val & 0xF) << shift);
+    } else {
+      arr[index] = val;
+    }
+  }
+
 public:
   /**
    * @brief Construct by specifying #counters, #hash and length of counters
    *
    * @param num_cnt    #counter
-   * @param num_hash    #hash
-   * @param cnt_length  length of each counter
+   * @param num_hash    #hash, at most `MAX_HASH`
+   * @param cnt_length  length of each counter, should be either 4 or 8
    */
   CountingBloomFilter(int32_t num_cnt, int32_t num_hash, int32_t cnt_length);
   /**
@@ -61,6 +109,15 @@ public:
    *
    */
   bool lookup(const FlowKey<key_len> &flowkey) const override;
+  /**
+   * @brief Look up a batch of flowkeys
+   * @details An overriding method. Counters of a group of `BATCH` flowkeys
+   * are hashed and prefetched first, and then resolved, so that cache misses
+   * of different flowkeys overlap.
+   *
+   */
+  void lookupMany(const FlowKey<key_len> *flowkeys, size_t num,
+                  boost::dynamic_bitset<> &result) const override;
   /**
    * @brief Remove a flowkey from the bloom filter
    * @details A non-overriding method
@@ -74,9 +131,9 @@ public:
   size_t size() const override;
   /**
    * @brief Reset the Bloom Filter
-   * @details A non-overriding method
+   *
    */
-  void clear();
+  void clear() override;
 };
 
 } // namespace OmniSketch::Sketch
@@ -89,85 +146,125 @@ public:
 
 namespace OmniSketch::Sketch {
 
-template <int32_t key_len, typename hash_t>
-CountingBloomFilter<key_len, hash_t>::CountingBloomFilter(int32_t num_cnt,
-                                                          int32_t num_hash,
-                                                          int32_t cnt_length)
-    : ncnt(Util::NextPrime(num_cnt)), nhash(num_hash) {
+template <int32_t key_len, typename hash_t, typename alloc_t>
+CountingBloomFilter<key_len, hash_t, alloc_t>::CountingBloomFilter(
+    int32_t num_cnt, int32_t num_hash, int32_t cnt_length)
+    : ncnt(Util::NextPrime(num_cnt)), nhash(num_hash), cnt_len(cnt_length) {
+  if (cnt_len != 4 && cnt_len != 8) {
+    throw std::invalid_argument(
+        "Invalid Argument: Counter length should be either 4 or 8, but got " +
+        std::to_string(cnt_len) + " instead.");
+  }
+  if (nhash <= 0 || nhash > MAX_HASH) {
+    throw std::invalid_argument(
+        "Invalid Argument: # hash should be in [1, " +
+        std::to_string(MAX_HASH) + "], but got " + std::to_string(nhash) +
+        " instead.");
+  }
+  max_cnt = (1 << cnt_len) - 1;
+  nbytes = cnt_len == 4 ? (ncnt + 1) >> 1 : ncnt;
   // hash functions
   hash_fns = new hash_t[num_hash];
-  // counter array
-  counter = new CH({static_cast<size_t>(ncnt)},
-                   {static_cast<size_t>(cnt_length)}, {});
+  // counter array, zero initialized
+  arr = alloc_t::template allocate<uint8_t>(nbytes);
 }
 
-template <int32_t key_len, typename hash_t>
-CountingBloomFilter<key_len, hash_t>::~CountingBloomFilter() {
+template <int32_t key_len, typename hash_t, typename alloc_t>
+CountingBloomFilter<key_len, hash_t, alloc_t>::~CountingBloomFilter() {
   delete[] hash_fns;
-  delete counter;
+  alloc_t::deallocate(arr, nbytes);
 }
 
-template <int32_t key_len, typename hash_t>
-void CountingBloomFilter<key_len, hash_t>::insert(
+template <int32_t key_len, typename hash_t, typename alloc_t>
+void CountingBloomFilter<key_len, hash_t, alloc_t>::insert(
     const FlowKey<key_len> &flowkey) {
+  int32_t idx[MAX_HASH];
   // if there is a 0
-  int32_t i = 0;
-  while (i < nhash) {
-    int32_t idx = hash_fns[i](flowkey) % ncnt;
-    if (counter->getCnt(idx) == 0)
-      break;
-    i++;
+  bool existed = true;
+  for (int32_t i = 0; i < nhash; ++i) {
+    idx[i] = hash_fns[i](flowkey) % ncnt;
+    existed = existed && getCnt(idx[i]) != 0;
   }
-  // increment the buckets
-  if (i < nhash) {
-    for (int32_t j = 0; j < nhash; ++j) {
-      counter->updateCnt(hash_fns[j](flowkey) % ncnt, 1);
+  // increment the buckets (saturating)
+  if (!existed) {
+    for (int32_t i = 0; i < nhash; ++i) {
+      uint8_t val = getCnt(idx[i]);
+      if (val < max_cnt)
+        setCnt(idx[i], val + 1);
     }
   }
 }
 
-template <int32_t key_len, typename hash_t>
-bool CountingBloomFilter<key_len, hash_t>::lookup(
+template <int32_t key_len, typename hash_t, typename alloc_t>
+bool CountingBloomFilter<key_len, hash_t, alloc_t>::lookup(
     const FlowKey<key_len> &flowkey) const {
   // if every counter is non-zero, return true
   for (int32_t i = 0; i < nhash; ++i) {
     int32_t idx = hash_fns[i](flowkey) % ncnt;
-    if (counter->getCnt(idx) == 0) {
+    if (getCnt(idx) == 0) {
       return false;
     }
   }
   return true;
 }
 
-template <int32_t key_len, typename hash_t>
-void CountingBloomFilter<key_len, hash_t>::remove(
+template <int32_t key_len, typename hash_t, typename alloc_t>
+void CountingBloomFilter<key_len, hash_t, alloc_t>::lookupMany(
+    const FlowKey<key_len> *flowkeys, size_t num,
+    boost::dynamic_bitset<> &result) const {
+  result.resize(num);
+  int32_t idx[BATCH * MAX_HASH];
+  for (size_t base = 0; base < num; base += BATCH) {
+    const size_t cnt = std::min(BATCH, num - base);
+    // stage 1: hash and prefetch
+    for (size_t k = 0; k < cnt; ++k) {
+      int32_t *pos = idx + k * nhash;
+      for (int32_t i = 0; i < nhash; ++i) {
+        pos[i] = hash_fns[i](flowkeys[base + k]) % ncnt;
+        __builtin_prefetch(arr + byteOf(pos[i]));
+      }
+    }
+    // stage 2: resolve
+    for (size_t k = 0; k < cnt; ++k) {
+      const int32_t *pos = idx + k * nhash;
+      bool existed = true;
+      for (int32_t i = 0; i < nhash && existed; ++i) {
+        existed = getCnt(pos[i]) != 0;
+      }
+      result[base + k] = existed;
+    }
+  }
+}
+
+template <int32_t key_len, typename hash_t, typename alloc_t>
+void CountingBloomFilter<key_len, hash_t, alloc_t>::remove(
     const FlowKey<key_len> &flowkey) {
+  int32_t idx[MAX_HASH];
   // if there is a 0
-  int32_t i = 0;
-  while (i < nhash) {
-    int32_t idx = hash_fns[i](flowkey) % ncnt;
-    if (counter->getCnt(idx) == 0)
-      break;
-    i++;
+  for (int32_t i = 0; i < nhash; ++i) {
+    idx[i] = hash_fns[i](flowkey) % ncnt;
+    if (getCnt(idx[i]) == 0)
+      return;
   }
-  // decrement the buckets
-  if (i == nhash) {
-    for (int32_t j = 0; j < nhash; ++j) {
-      counter->updateCnt(hash_fns[j](flowkey) % ncnt, -1);
-    }
+  // decrement the buckets, except for the saturated ones and those already
+  // drained by a duplicate index
+  for (int32_t i = 0; i < nhash; ++i) {
+    uint8_t val = getCnt(idx[i]);
+    if (val != 0 && val < max_cnt)
+      setCnt(idx[i], val - 1);
   }
 }
 
-template <int32_t key_len, typename hash_t>
-size_t CountingBloomFilter<key_len, hash_t>::size() const {
+template <int32_t key_len, typename hash_t, typename alloc_t>
+size_t CountingBloomFilter<key_len, hash_t, alloc_t>::size() const {
   return sizeof(*this)            // instance
          + sizeof(hash_t) * nhash // hash functions
-         + counter->size();       // counter size
+         + nbytes;                // counter size
 }
 
-template <int32_t key_len, typename hash_t>
-void CountingBloomFilter<key_len, hash_t>::clear() {
-  counter->clear();
+template <int32_t key_len, typename hash_t, typename alloc_t>
+void CountingBloomFilter<key_len, hash_t, alloc_t>::clear() {
+  std::fill(arr, arr + nbytes, 0);
 }
 
 } // namespace OmniSketch::Sketch
\ No newline at end of file
@@ -0,0 +1,328 @@
+/**
+ * @file ElasticSketch.h
+ * @author dromniscience (you@domain.com)
+ * @brief Implementation of Elastic Sketch
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <common/counter.h>
+#include <common/hash.h>
+#include <common/sketch.h>
+
+namespace OmniSketch::Sketch {
+/**
+ * @brief Elastic Sketch
+ *
+ * @details Flows are separated into a heavy part and a light part. The heavy
+ * part is an array of buckets, each holding up to `ENTRIES` flowkeys with
+ * their positive votes, and the negative votes of the bucket. A packet is
+ * hashed to a single bucket:
+ * - if its flowkey is there, or there is an empty entry, the packet is
+ * counted as a positive vote and that's it, which is the case for most
+ * packets under skew;
+ * - otherwise it is a negative vote. Once the negative votes reach `lambda`
+ * times the smallest positive votes in the bucket, that flow is evicted to the
+ * light part and the new flowkey takes its entry, marked as having earlier
+ * packets in the light part. Until then, the packet goes to the light part.
+ *
+ * The light part is a Count Min Sketch, whose counters are cells of type
+ * `cell_t` (e.g., `uint8_t` as in the paper) that escalate on overflow. See
+ * Util::CounterTable.
+ *
+ * @tparam key_len  length of flowkey
+ * @tparam T        type of the counter
+ * @tparam hash_t   hashing class
+ * @tparam cell_t   type of the cell holding a counter of the light part
+ * @tparam alloc_t  allocation policy of the buckets and counters (see
+ * alloc.h)
+ */
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash,
+          typename cell_t = T, typename alloc_t = Util::DefaultAlloc>
+class ElasticSketch : public SketchBase<key_len, T> {
+private:
+  /**
+   * @brief # entries in a bucket of the heavy part
+   *
+   */
+  static constexpr int32_t ENTRIES = 8;
+  /**
+   * @brief A bucket of the heavy part
+   * @details Entries are filled in order and an entry with no positive vote
+   * is empty. Bit `i` of `flag` is set iff the flowkey in entry `i` may have
+   * packets in the light part.
+   */
+  struct Bucket {
+    FlowKey<key_len> key[ENTRIES];
+    T pos[ENTRIES];
+    T neg;
+    uint8_t flag;
+  };
+
+  int32_t num_bucket;
+  int32_t lambda;
+  Bucket *buckets;
+  hash_t heavy_hash;
+  Util::CounterTable<T, cell_t, 0, 0, alloc_t> light;
+  hash_t *light_hash;
+
+  ElasticSketch(const ElasticSketch &) = delete;
+  ElasticSketch(ElasticSketch &&) = delete;
+  ElasticSketch &operator=(ElasticSketch) = delete;
+
+  /**
+   * @brief Update the light part
+   *
+   */
+  void updateLight(const FlowKey<key_len> &flowkey, T val);
+  /**
+   * @brief Query the light part
+   *
+   */
+  T queryLight(const FlowKey<key_len> &flowkey) const;
+
+public:
+  /**
+   * @brief Construct by specifying the heavy part and the light part
+   *
+   * @param num_bucket_ # buckets in the heavy part
+   * @param depth_      depth of the light part
+   * @param width_      width of the light part (rounded up to a prime)
+   * @param lambda_     ratio of negative votes to positive ones that triggers
+   * an eviction
+   */
+  ElasticSketch(int32_t num_bucket_, int32_t depth_, int32_t width_,
+                int32_t lambda_ = 8);
+  /**
+   * @brief Release the pointers
+   *
+   */
+  ~ElasticSketch();
+  /**
+   * @brief Update a flowkey with certain value
+   *
+   */
+  void update(const FlowKey<key_len> &flowkey, T val) override;
+  /**
+   * @brief Query a flowkey
+   * @details The positive votes if the flowkey is in the heavy part, plus the
+   * estimate of the light part if it may have packets there.
+   */
+  T query(const FlowKey<key_len> &flowkey) const override;
+  /**
+   * @brief Get the heavy hitters among flowkeys in the heavy part
+   *
+   * @param threshold A flowkey is a HH iff its estimate `>= threshold`
+   */
+  Data::Estimation<key_len, T> getHeavyHitter(double threshold) const override;
+  /**
+   * @brief Get the heavy changers among flowkeys in the heavy part of either
+   * sketch
+   * @details The other sketch should be an Elastic Sketch of the same type,
+   * otherwise std::invalid_argument is thrown.
+   *
+   * @param ptr_sketch  the other sketch
+   * @param threshold   A flowkey is a HC iff the difference of its estimates
+   * `>= threshold`
+   */
+  Data::Estimation<key_len, T>
+  getHeavyChanger(std::unique_ptr<SketchBase<key_len, T>> &ptr_sketch,
+                  double threshold) const override;
+  /**
+   * @brief Decode the flowkeys in the heavy part with their estimates
+   * @details Flows that only reach the light part cannot be decoded.
+   *
+   */
+  Data::Estimation<key_len, T> decode() override;
+  /**
+   * @brief Get the size of the sketch
+   *
+   */
+  size_t size() const override;
+  /**
+   * @brief Reset the sketch
+   *
+   */
+  void clear() override;
+};
+
+} // namespace OmniSketch::Sketch
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Sketch {
+
+template <int32_t key_len, typename T, typename hash_t, typename cell_t,
+          typename alloc_t>
+ElasticSketch<key_len, T, hash_t, cell_t, alloc_t>::ElasticSketch(
+    int32_t num_bucket_, int32_t depth_, int32_t width_, int32_t lambda_)
+    : num_bucket(num_bucket_), lambda(lambda_),
+      light(depth_, Util::NextPrime(width_)) {
+  if (num_bucket <= 0 || lambda <= 0) {
+    throw std::invalid_argument(
+        "Invalid Argument: # buckets and lambda should be positive.");
+  }
+  buckets = alloc_t::template allocate<Bucket>(num_bucket);
+  light_hash = new hash_t[depth_];
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename cell_t,
+          typename alloc_t>
+ElasticSketch<key_len, T, hash_t, cell_t, alloc_t>::~ElasticSketch() {
+  alloc_t::deallocate(buckets, num_bucket);
+  delete[] light_hash;
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename cell_t,
+          typename alloc_t>
+void ElasticSketch<key_len, T, hash_t, cell_t, alloc_t>::updateLight(
+    const FlowKey<key_len> &flowkey, T val) {
+  for (int32_t i = 0; i < light.rows(); ++i) {
+    int32_t index = light_hash[i](flowkey) % light.cols();
+    light.add(light.offset(i, index), val);
+  }
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename cell_t,
+          typename alloc_t>
+T ElasticSketch<key_len, T, hash_t, cell_t, alloc_t>::queryLight(
+    const FlowKey<key_len> &flowkey) const {
+  T min_val = std::numeric_limits<T>::max();
+  for (int32_t i = 0; i < light.rows(); ++i) {
+    int32_t index = light_hash[i](flowkey) % light.cols();
+    min_val = std::min(min_val, light.get(light.offset(i, index)));
+  }
+  return min_val;
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename cell_t,
+          typename alloc_t>
+void ElasticSketch<key_len, T, hash_t, cell_t, alloc_t>::update(
+    const FlowKey<key_len> &flowkey, T val) {
+  Bucket &bucket = buckets[heavy_hash(flowkey) % num_bucket];
+  int32_t min_i = 0;
+  for (int32_t i = 0; i < ENTRIES; ++i) {
+    if (bucket.pos[i] == 0) {
+      // empty, and so are the entries after it
+      bucket.key[i] = flowkey;
+      bucket.pos[i] = val;
+      return;
+    }
+    if (bucket.key[i] == flowkey) {
+      bucket.pos[i] += val;
+      return;
+    }
+    if (bucket.pos[i] < bucket.pos[min_i]) {
+      min_i = i;
+    }
+  }
+  // a negative vote
+  bucket.neg += val;
+  if (bucket.neg < static_cast<T>(lambda) * bucket.pos[min_i]) {
+    updateLight(flowkey, val);
+    return;
+  }
+  // evict the smallest flow to the light part
+  updateLight(bucket.key[min_i], bucket.pos[min_i]);
+  bucket.key[min_i] = flowkey;
+  bucket.pos[min_i] = val;
+  bucket.neg = 0;
+  bucket.flag |= 1U << min_i;
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename cell_t,
+          typename alloc_t>
+T ElasticSketch<key_len, T, hash_t, cell_t, alloc_t>::query(
+    const FlowKey<key_len> &flowkey) const {
+  const Bucket &bucket = buckets[heavy_hash(flowkey) % num_bucket];
+  for (int32_t i = 0; i < ENTRIES && bucket.pos[i]; ++i) {
+    if (bucket.key[i] == flowkey) {
+      return bucket.pos[i] +
+             ((bucket.flag >> i & 1) ? queryLight(flowkey) : 0);
+    }
+  }
+  return queryLight(flowkey);
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename cell_t,
+          typename alloc_t>
+Data::Estimation<key_len, T>
+ElasticSketch<key_len, T, hash_t, cell_t, alloc_t>::getHeavyHitter(
+    double threshold) const {
+  Data::Estimation<key_len, T> heavy_hitters;
+  for (int32_t b = 0; b < num_bucket; ++b) {
+    const Bucket &bucket = buckets[b];
+    for (int32_t i = 0; i < ENTRIES && bucket.pos[i]; ++i) {
+      T estimate_val = bucket.pos[i];
+      if (bucket.flag >> i & 1) {
+        estimate_val += queryLight(bucket.key[i]);
+      }
+      if (estimate_val >= threshold) {
+        heavy_hitters[bucket.key[i]] = estimate_val;
+      }
+    }
+  }
+  return heavy_hitters;
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename cell_t,
+          typename alloc_t>
+Data::Estimation<key_len, T>
+ElasticSketch<key_len, T, hash_t, cell_t, alloc_t>::getHeavyChanger(
+    std::unique_ptr<SketchBase<key_len, T>> &ptr_sketch,
+    double threshold) const {
+  const ElasticSketch *other = dynamic_cast<ElasticSketch *>(ptr_sketch.get());
+  if (!other) {
+    throw std::invalid_argument("Invalid Argument: Heavy changers are only "
+                                "detected between Elastic Sketches.");
+  }
+  Data::Estimation<key_len, T> heavy_changers;
+  // candidates are flowkeys in the heavy part of either sketch
+  for (const ElasticSketch *sketch : {this, other}) {
+    for (int32_t b = 0; b < sketch->num_bucket; ++b) {
+      const Bucket &bucket = sketch->buckets[b];
+      for (int32_t i = 0; i < ENTRIES && bucket.pos[i]; ++i) {
+        const FlowKey<key_len> &flowkey = bucket.key[i];
+        if (heavy_changers.count(flowkey))
+          continue;
+        T change = std::abs(query(flowkey) - other->query(flowkey));
+        if (change >= threshold) {
+          heavy_changers[flowkey] = change;
+        }
+      }
+    }
+  }
+  return heavy_changers;
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename cell_t,
+          typename alloc_t>
+Data::Estimation<key_len, T>
+ElasticSketch<key_len, T, hash_t, cell_t, alloc_t>::decode() {
+  // every flowkey in the heavy part
+  return getHeavyHitter(0);
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename cell_t,
+          typename alloc_t>
+size_t ElasticSketch<key_len, T, hash_t, cell_t, alloc_t>::size() const {
+  return sizeof(*this)                   // instance
+         + sizeof(hash_t) * light.rows() // hashing class
+         + sizeof(Bucket) * num_bucket   // heavy part
+         + light.size();                 // light part
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename cell_t,
+          typename alloc_t>
+void ElasticSketch<key_len, T, hash_t, cell_t, alloc_t>::clear() {
+  std::fill(buckets, buckets + num_bucket, Bucket());
+  light.clear();
+}
+
+} // namespace OmniSketch::Sketch
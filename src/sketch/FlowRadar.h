@@ -19,8 +19,11 @@ namespace OmniSketch::Sketch {
  * @tparam key_len  length of flowkey
  * @tparam T        type of the counter
  * @tparam hash_t   hashing class
+ * @tparam alloc_t  allocation policy of the count table and the flow filter
+ * (see alloc.h)
  */
-template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash>
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash,
+          typename alloc_t = Util::DefaultAlloc>
 class FlowRadar : public SketchBase<key_len, T> {
 private:
   struct CountTableEntry {
@@ -36,13 +39,24 @@ private:
   const int32_t num_count_hash;
   int32_t num_flows;
 
-  hash_t *hash_fns;
-  BloomFilter<key_len, hash_t> *flow_filter;
+  hash_t hash_fn;
+  BloomFilter<key_len, hash_t, 0, 0, alloc_t> *flow_filter;
   CountTableEntry *count_table;
 
   FlowRadar(const FlowRadar &) = delete;
   FlowRadar(FlowRadar &&) = delete;
 
+  /**
+   * @brief Hash a flowkey into the count table
+   * @details All `num_count_hash` indices are derived from a single hash value
+   * by double hashing, i.e., the i-th index is `(first + i * step) %
+   * num_count_table`. Since `num_count_table` is a prime, these indices are
+   * pairwise distinct as long as `num_count_hash <= num_count_table`.
+   *
+   * @return a pair of `(first, step)`
+   */
+  std::pair<int32_t, int32_t> countHash(const FlowKey<key_len> &flowkey) const;
+
 public:
   /**
    * @brief Construct a new Flow Radar object
@@ -50,7 +64,8 @@ public:
    * @param flow_filter_size Number of bits in flow filter (a Bloom Filter)
    * @param flow_filter_hash Number of hash functions in flow filter
    * @param count_table_size Number of elements in count table
-   * @param count_table_hash Number of hash functions in count table
+   * @param count_table_hash Number of indices each flow is hashed to in count
+   * table
    */
   FlowRadar(int32_t flow_filter_size, int32_t flow_filter_hash,
             int32_t count_table_size, int32_t count_table_hash);
@@ -73,7 +88,7 @@ public:
    * @brief Reset the sketch
    *
    */
-  void clear();
+  void clear() override;
   /**
    * @brief Get the size of the sketch
    *
@@ -91,41 +106,60 @@ public:
 
 namespace OmniSketch::Sketch {
 
-template <int32_t key_len, typename T, typename hash_t>
-FlowRadar<key_len, T, hash_t>::FlowRadar(int32_t flow_filter_size,
-                                         int32_t flow_filter_hash,
-                                         int32_t count_table_size,
-                                         int32_t count_table_hash)
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+FlowRadar<key_len, T, hash_t, alloc_t>::FlowRadar(int32_t flow_filter_size,
+                                                  int32_t flow_filter_hash,
+                                                  int32_t count_table_size,
+                                                  int32_t count_table_hash)
     : num_bitmap(Util::NextPrime(flow_filter_size)),
       num_bit_hash(flow_filter_hash),
       num_count_table(Util::NextPrime(count_table_size)),
       num_count_hash(count_table_hash), num_flows(0) {
-  hash_fns = new hash_t[num_count_hash];
+  if (num_count_hash > num_count_table) {
+    throw std::invalid_argument(
+        "Invalid Argument: `count_table_hash` should not exceed the size of "
+        "count table, but got " +
+        std::to_string(num_count_hash) + " > " +
+        std::to_string(num_count_table) + ".");
+  }
   // flow filter
-  flow_filter = new BloomFilter<key_len, hash_t>(num_bitmap, num_bit_hash);
+  flow_filter = new BloomFilter<key_len, hash_t, 0, 0, alloc_t>(num_bitmap,
+                                                                num_bit_hash);
   // count table
-  count_table = new CountTableEntry[num_count_table]();
+  count_table = alloc_t::template allocate<CountTableEntry>(num_count_table);
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-FlowRadar<key_len, T, hash_t>::~FlowRadar() {
-  delete[] hash_fns;
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+FlowRadar<key_len, T, hash_t, alloc_t>::~FlowRadar() {
   delete flow_filter;
-  delete[] count_table;
+  alloc_t::deallocate(count_table, num_count_table);
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+std::pair<int32_t, int32_t> FlowRadar<key_len, T, hash_t, alloc_t>::countHash(
+    const FlowKey<key_len> &flowkey) const {
+  uint64_t hash_val = hash_fn(flowkey);
+  int32_t first =
+      static_cast<int32_t>((hash_val & 0xFFFFFFFF) % num_count_table);
+  int32_t step = 1;
+  if (num_count_table > 1) {
+    step += static_cast<int32_t>((hash_val >> 32) % (num_count_table - 1));
+  }
+  return {first, step};
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void FlowRadar<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey,
-                                           T val) {
-  bool exist = flow_filter->lookup(flowkey);
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+void FlowRadar<key_len, T, hash_t, alloc_t>::update(
+    const FlowKey<key_len> &flowkey, T val) {
+  // test-and-set on the flow filter
+  bool exist = !flow_filter->insertIfAbsent(flowkey);
   // a new flow
   if (!exist) {
-    flow_filter->insert(flowkey);
     num_flows++;
   }
 
+  auto [index, step] = countHash(flowkey);
   for (int32_t i = 0; i < num_count_hash; i++) {
-    int32_t index = hash_fns[i](flowkey) % num_count_table;
     // a new flow
     if (!exist) {
       count_table[index].flow_count++;
@@ -133,11 +167,15 @@ void FlowRadar<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey,
     }
     // increment packet count
     count_table[index].packet_count += val;
+    // next index
+    index += step;
+    if (index >= num_count_table)
+      index -= num_count_table;
   }
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-Data::Estimation<key_len, T> FlowRadar<key_len, T, hash_t>::decode() {
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+Data::Estimation<key_len, T> FlowRadar<key_len, T, hash_t, alloc_t>::decode() {
   // an optimized implementation
   class CompareFlowCount {
   public:
@@ -169,36 +207,37 @@ Data::Estimation<key_len, T> FlowRadar<key_len, T, hash_t>::decode() {
 
     FlowKey<key_len> flowkey = count_table[index].flowXOR;
     T size = count_table[index].packet_count;
+    auto [l, step] = countHash(flowkey);
     for (int i = 0; i < num_count_hash; ++i) {
-      int l = hash_fns[i](flowkey) % num_count_table;
       set.erase(count_table + l);
       count_table[l].flow_count--;
       count_table[l].packet_count -= size;
       count_table[l].flowXOR ^= flowkey;
       set.insert(count_table + l);
+      l += step;
+      if (l >= num_count_table)
+        l -= num_count_table;
     }
     est[flowkey] = size;
   }
   return est;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-size_t FlowRadar<key_len, T, hash_t>::size() const {
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+size_t FlowRadar<key_len, T, hash_t, alloc_t>::size() const {
   return sizeof(*this)                                 // instance
-         + num_count_hash * sizeof(hash_t)             // hashing class
          + num_count_table * (sizeof(T) * 2 + key_len) // count table
          + flow_filter->size();                        // flow filter
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void FlowRadar<key_len, T, hash_t>::clear() {
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+void FlowRadar<key_len, T, hash_t, alloc_t>::clear() {
   // reset flow counter
   num_flows = 0;
   // reset flow filter
   flow_filter->clear();
-  // reset count table
-  delete[] count_table;
-  count_table = new CountTableEntry[num_count_table]();
+  // reset count table in place
+  std::fill(count_table, count_table + num_count_table, CountTableEntry());
 }
 
 } // namespace OmniSketch::Sketch
\ No newline at end of file
@@ -8,40 +8,142 @@
  */
 #pragma once
 
+#include <common/alloc.h>
 #include <common/hash.h>
+#include <common/ring.h>
 #include <common/sketch.h>
+#include <memory>
+#include <thread>
+#include <unordered_map>
 
 namespace OmniSketch::Sketch {
 /**
  * @brief Hash Pipe
  *
+ * @details By default all stages run serially inside update(). After
+ * setPipeline(), stages are split into contiguous groups, each run by a worker
+ * thread, as stages of a switch pipeline would. update() then only enqueues
+ * the flowkey, and carries evicted by a group are passed on to the next one
+ * through a lock-free SPSC ring. Since every group handles its carries in
+ * arrival order, the resulting slots are identical to the serial ones.
+ *
  * @tparam key_len  length of flowkey
  * @tparam T        type of the counter
  * @tparam hash_t   hashing class
+ * @tparam alloc_t  allocation policy of the slots (see alloc.h)
  */
-template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash>
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash,
+          typename alloc_t = Util::DefaultAlloc>
 class HashPipe : public SketchBase<key_len, T> {
 private:
-  class Entry {
-  public:
-    FlowKey<key_len> flowkey;
-    T val;
-  };
   int32_t depth;
   int32_t width;
   hash_t *hash_fns;
-  Entry **slots;
+  /**
+   * @brief Slots are stored column-wise: the `j`-th slot of stage `i` is at
+   * `i * width + j` in each of the arrays below.
+   *
+   */
+  FlowKey<key_len> *keys;
+  T *vals;
+  /**
+   * @brief 16-bit fingerprints of the keys, 0 marking an empty slot
+   * @details `nullptr` unless fingerprints are enabled. A flowkey is compared
+   * against a slot only if their fingerprints match.
+   */
+  uint16_t *fps;
+
+  /**
+   * @brief A flowkey travelling down the pipe
+   *
+   */
+  struct Carry {
+    FlowKey<key_len> flowkey;
+    T val;
+    uint16_t fp;
+  };
+  /**
+   * @brief Capacity of the ring in front of each stage group
+   *
+   */
+  static constexpr size_t RING_SIZE = 1024;
+  /**
+   * @brief Worker threads, empty in the serial mode
+   *
+   */
+  std::vector<std::thread> workers;
+  /**
+   * @brief Group `g` runs stages `[bound[g], bound[g + 1])`
+   *
+   */
+  std::vector<int32_t> bound;
+  /**
+   * @brief `rings[g]` feeds group `g`
+   *
+   */
+  std::vector<std::unique_ptr<Util::SPSCRing<Carry>>> rings;
+  /**
+   * @brief `retired[g]` counts carries that end in group `g`, i.e., absorbed
+   * by a slot or dropped after the last stage
+   *
+   */
+  std::unique_ptr<std::atomic<uint64_t>[]> retired;
+  /**
+   * @brief # flowkeys enqueued by update() in the pipelined mode
+   *
+   */
+  uint64_t submitted;
+  std::atomic<bool> running;
 
   HashPipe(const HashPipe &) = delete;
   HashPipe(HashPipe &&) = delete;
   HashPipe &operator=(HashPipe) = delete;
 
+  /**
+   * @brief Nonzero fingerprint derived from the hash value of the first stage
+   *
+   */
+  static uint16_t fingerprint(uint64_t hash_val) {
+    uint16_t fp = static_cast<uint16_t>(hash_val >> 48);
+    return fp ? fp : 1;
+  }
+  /**
+   * @brief Whether a slot is empty
+   *
+   */
+  bool isEmpty(size_t pos) const {
+    return fps ? fps[pos] == 0 : keys[pos] == FlowKey<key_len>();
+  }
+  /**
+   * @brief Whether a slot holds the flowkey with such fingerprint
+   *
+   */
+  bool isHit(size_t pos, const FlowKey<key_len> &flowkey, uint16_t fp) const {
+    return (!fps || fps[pos] == fp) && keys[pos] == flowkey;
+  }
+  /**
+   * @brief Feed a carry to the `i`-th stage
+   *
+   * @return `true` if a carry (possibly a different one) is left for the next
+   * stage
+   */
+  bool runStage(int32_t i, Carry &carry);
+  /**
+   * @brief Main loop of the worker running stage group `g`
+   *
+   */
+  void work(size_t g);
+
 public:
   /**
    * @brief Construct by specifying depth and width
    *
+   * @param depth_        # stages
+   * @param width_        # slots per stage
+   * @param fingerprint_  whether to guard key comparisons with 16-bit
+   * fingerprints
    */
-  HashPipe(int32_t depth_, int32_t width_);
+  HashPipe(int32_t depth_, int32_t width_, bool fingerprint_ = false);
   /**
    * @brief Release the pointer
    *
@@ -59,6 +161,11 @@ public:
   T query(const FlowKey<key_len> &flowkey) const override;
   /**
    * @brief Get Heavy Hitter
+   * @details Since a flowkey can only reside in the slot it is hashed to in
+   * each stage, its estimate is the sum of all the slots holding it. So values
+   * are aggregated in a single pass over the slots without hashing the keys
+   * again.
+   *
    * @param threshold A flowkey is a HH iff its counter `>= threshold`
    *
    */
@@ -72,7 +179,29 @@ public:
    * @brief Reset the sketch
    *
    */
-  void clear();
+  void clear() override;
+  /**
+   * @brief Switch between the serial and the pipelined mode
+   * @details A non-overriding method. Pending flowkeys are settled before
+   * switching.
+   *
+   * @param num_threads # stage groups, each run by a thread, should be in
+   * `[0, depth]`. 0 means the serial mode.
+   */
+  void setPipeline(int32_t num_threads);
+  /**
+   * @brief Wait until all the enqueued flowkeys settle
+   * @details A non-overriding method. Called implicitly by query(),
+   * getHeavyHitter() and clear(). Does nothing in the serial mode.
+   */
+  void sync() const;
+  /**
+   * @brief # carries handled by each stage group so far
+   * @details A non-overriding method. Under skew most flowkeys are absorbed by
+   * the first stage, so later groups see much fewer carries. Empty in the
+   * serial mode.
+   */
+  std::vector<uint64_t> pipelineLoad() const;
 };
 
 } // namespace OmniSketch::Sketch
@@ -85,120 +214,219 @@ public:
 
 namespace OmniSketch::Sketch {
 
-template <int32_t key_len, typename T, typename hash_t>
-HashPipe<key_len, T, hash_t>::HashPipe(int32_t depth_, int32_t width_)
-    : depth(depth_), width(Util::NextPrime(width_)) {
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+HashPipe<key_len, T, hash_t, alloc_t>::HashPipe(int32_t depth_, int32_t width_,
+                                                bool fingerprint_)
+    : depth(depth_), width(Util::NextPrime(width_)), fps(nullptr),
+      submitted(0), running(false) {
 
   hash_fns = new hash_t[depth];
   // Allocate continuous memory
-  slots = new Entry *[depth];
-  slots[0] = new Entry[depth * width](); // Init with zero
-  for (int32_t i = 1; i < depth; ++i) {
-    slots[i] = slots[i - 1] + width;
+  keys = alloc_t::template allocate<FlowKey<key_len>>(depth * width);
+  vals = alloc_t::template allocate<T>(depth * width); // Init with zero
+  if (fingerprint_) {
+    fps = alloc_t::template allocate<uint16_t>(depth * width);
   }
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-HashPipe<key_len, T, hash_t>::~HashPipe() {
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+HashPipe<key_len, T, hash_t, alloc_t>::~HashPipe() {
+  setPipeline(0);
   delete[] hash_fns;
-  delete[] slots[0];
-  delete[] slots;
+  alloc_t::deallocate(keys, depth * width);
+  alloc_t::deallocate(vals, depth * width);
+  alloc_t::deallocate(fps, depth * width);
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void HashPipe<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey,
-                                          T val) {
-  // The first stage
-  int idx = hash_fns[0](flowkey) % width;
-  FlowKey<key_len> empty_key;
-  FlowKey<key_len> c_key;
-  T c_val;
-  if (slots[0][idx].flowkey == flowkey) {
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+bool HashPipe<key_len, T, hash_t, alloc_t>::runStage(int32_t i, Carry &carry) {
+  size_t pos;
+  if (i == 0) {
+    uint64_t hash_val = hash_fns[0](carry.flowkey);
+    carry.fp = fingerprint(hash_val);
+    pos = hash_val % width;
+  } else {
+    pos = i * static_cast<size_t>(width) + hash_fns[i](carry.flowkey) % width;
+  }
+  if (isHit(pos, carry.flowkey, carry.fp)) {
     // flowkey hit
-    slots[0][idx].val += val;
-    return;
-  } else if (slots[0][idx].flowkey == empty_key) {
+    vals[pos] += carry.val;
+    return false;
+  } else if (isEmpty(pos)) {
     // empty
-    slots[0][idx].val = val;
-    slots[0][idx].flowkey = flowkey;
+    keys[pos] = carry.flowkey;
+    vals[pos] = carry.val;
+    if (fps)
+      fps[pos] = carry.fp;
+    return false;
+  } else if (i == 0 || vals[pos] < carry.val) {
+    // swap: the first stage always admits the new flowkey
+    std::swap(carry.flowkey, keys[pos]);
+    std::swap(carry.val, vals[pos]);
+    if (fps)
+      std::swap(carry.fp, fps[pos]);
+  }
+  return true;
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+void HashPipe<key_len, T, hash_t, alloc_t>::update(
+    const FlowKey<key_len> &flowkey, T val) {
+  Carry carry{flowkey, val, 0};
+  if (!workers.empty()) {
+    while (!rings[0]->tryPush(carry)) {
+      std::this_thread::yield();
+    }
+    submitted++;
     return;
-  } else {
-    // swap
-    c_key = slots[0][idx].flowkey;
-    c_val = slots[0][idx].val;
-    slots[0][idx].flowkey = flowkey;
-    slots[0][idx].val = val;
-  }
-  // Later stages
-  for (int i = 1; i < depth; ++i) {
-    idx = hash_fns[i](c_key) % width;
-    if (slots[i][idx].flowkey == c_key) {
-      slots[i][idx].val += c_val;
-      return;
-    } else if (slots[i][idx].flowkey == empty_key) {
-      slots[i][idx].flowkey = c_key;
-      slots[i][idx].val = c_val;
-      return;
-    } else if (slots[i][idx].val < c_val) {
-      // swap
-      // slots[i][idx].swap(c_key);
-      auto tmpkey = c_key;
-      c_key = slots[i][idx].flowkey;
-      slots[i][idx].flowkey = tmpkey;
-      std::swap(c_val, slots[i][idx].val);
+  }
+  for (int32_t i = 0; i < depth && runStage(i, carry); ++i) {
+  }
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+void HashPipe<key_len, T, hash_t, alloc_t>::work(size_t g) {
+  const bool last = (g + 1 == rings.size());
+  uint64_t done = 0;
+  Carry carry;
+  while (running.load(std::memory_order_relaxed)) {
+    if (!rings[g]->tryPop(carry)) {
+      std::this_thread::yield();
+      continue;
+    }
+    bool left = true;
+    for (int32_t i = bound[g]; left && i < bound[g + 1]; ++i) {
+      left = runStage(i, carry);
+    }
+    if (left && !last) {
+      while (!rings[g + 1]->tryPush(carry)) {
+        std::this_thread::yield();
+      }
+    } else {
+      retired[g].store(++done, std::memory_order_release);
     }
   }
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-T HashPipe<key_len, T, hash_t>::query(const FlowKey<key_len> &flowkey) const {
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+T HashPipe<key_len, T, hash_t, alloc_t>::query(
+    const FlowKey<key_len> &flowkey) const {
+  sync();
   T ret = 0;
+  uint64_t hash_val = hash_fns[0](flowkey);
+  uint16_t fp = fingerprint(hash_val);
   for (int i = 0; i < depth; ++i) {
-    int idx = hash_fns[i](flowkey) % width;
-    if (slots[i][idx].flowkey == flowkey) {
-      ret += slots[i][idx].val;
+    size_t pos = i * static_cast<size_t>(width) +
+                 (i ? hash_fns[i](flowkey) : hash_val) % width;
+    if (isHit(pos, flowkey, fp)) {
+      ret += vals[pos];
     }
   }
   return ret;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
 Data::Estimation<key_len, T>
-HashPipe<key_len, T, hash_t>::getHeavyHitter(double threshold) const {
+HashPipe<key_len, T, hash_t, alloc_t>::getHeavyHitter(double threshold) const {
+  sync();
+  const size_t num_slot = static_cast<size_t>(depth) * width;
+  std::unordered_map<FlowKey<key_len>, T> sum;
+  sum.reserve(num_slot);
+  for (size_t pos = 0; pos < num_slot; ++pos) {
+    if (!isEmpty(pos)) {
+      sum[keys[pos]] += vals[pos];
+    }
+  }
   Data::Estimation<key_len, T> heavy_hitters;
-  std::set<FlowKey<key_len>> checked;
-  for (int i = 0; i < depth; ++i) {
-    for (int j = 0; j < width; ++j) {
-      const auto &flowkey = slots[i][j].flowkey;
-      if (checked.find(flowkey) != checked.end()) {
-        continue;
-      }
-      checked.insert(flowkey);
-      auto estimate_val = query(flowkey);
-      if (estimate_val >= threshold) {
-        heavy_hitters[flowkey] = estimate_val;
-      }
+  for (const auto &[flowkey, estimate_val] : sum) {
+    if (estimate_val >= threshold) {
+      heavy_hitters[flowkey] = estimate_val;
     }
   }
   return heavy_hitters;
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-size_t HashPipe<key_len, T, hash_t>::size() const {
-  return sizeof(*this)                    // instance
-         + sizeof(hash_t) * depth         // hashing class
-         + sizeof(Entry) * depth * width; // slots
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+size_t HashPipe<key_len, T, hash_t, alloc_t>::size() const {
+  return sizeof(*this)                                  // instance
+         + sizeof(hash_t) * depth                       // hashing class
+         + sizeof(FlowKey<key_len>) * depth * width     // keys
+         + sizeof(T) * depth * width                    // values
+         + (fps ? sizeof(uint16_t) * depth * width : 0); // fingerprints
 }
 
-template <int32_t key_len, typename T, typename hash_t>
-void HashPipe<key_len, T, hash_t>::clear() {
-  FlowKey<key_len> empty_key;
-  for (int i = 0; i < depth; ++i) {
-    for (int j = 0; j < width; ++j) {
-      slots[i][j].flowkey = empty_key;
-      slots[i][j].val = 0;
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+void HashPipe<key_len, T, hash_t, alloc_t>::clear() {
+  sync();
+  std::fill(keys, keys + depth * width, FlowKey<key_len>());
+  std::fill(vals, vals + depth * width, 0);
+  if (fps) {
+    std::fill(fps, fps + depth * width, 0);
+  }
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+void HashPipe<key_len, T, hash_t, alloc_t>::setPipeline(int32_t num_threads) {
+  if (num_threads < 0 || num_threads > depth) {
+    throw std::out_of_range("Out of Range: # pipeline threads should be in "
+                            "[0, depth], but got " +
+                            std::to_string(num_threads) + " instead.");
+  }
+  // stop the current pipeline
+  sync();
+  running.store(false, std::memory_order_relaxed);
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  workers.clear();
+  rings.clear();
+  bound.clear();
+  retired.reset();
+  submitted = 0;
+  if (num_threads == 0)
+    return;
+
+  // split stages as evenly as possible
+  for (int32_t g = 0; g <= num_threads; ++g) {
+    bound.push_back(g * depth / num_threads);
+  }
+  retired.reset(new std::atomic<uint64_t>[num_threads]);
+  for (int32_t g = 0; g < num_threads; ++g) {
+    rings.emplace_back(new Util::SPSCRing<Carry>(RING_SIZE));
+    retired[g].store(0, std::memory_order_relaxed);
+  }
+  running.store(true, std::memory_order_relaxed);
+  for (int32_t g = 0; g < num_threads; ++g) {
+    workers.emplace_back(&HashPipe::work, this, g);
+  }
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+void HashPipe<key_len, T, hash_t, alloc_t>::sync() const {
+  if (workers.empty())
+    return;
+  while (true) {
+    uint64_t settled = 0;
+    for (size_t g = 0; g < workers.size(); ++g) {
+      settled += retired[g].load(std::memory_order_acquire);
     }
+    if (settled == submitted)
+      return;
+    std::this_thread::yield();
+  }
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+std::vector<uint64_t>
+HashPipe<key_len, T, hash_t, alloc_t>::pipelineLoad() const {
+  // a carry handled by group g either retires there or moves on to g + 1
+  std::vector<uint64_t> load(workers.size());
+  uint64_t sum = 0;
+  for (size_t g = workers.size(); g-- > 0;) {
+    sum += retired[g].load(std::memory_order_acquire);
+    load[g] = sum;
   }
+  return load;
 }
 
 } // namespace OmniSketch::Sketch
\ No newline at end of file
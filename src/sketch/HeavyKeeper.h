@@ -0,0 +1,228 @@
+/**
+ * @file HeavyKeeper.h
+ * @author dromniscience (you@domain.com)
+ * @brief Implementation of HeavyKeeper
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <cmath>
+#include <common/hash.h>
+#include <common/sketch.h>
+#include <common/table.h>
+#include <common/topk.h>
+#include <random>
+
+namespace OmniSketch::Sketch {
+/**
+ * @brief HeavyKeeper
+ *
+ * @details Each of the `depth` rows is an array of buckets, each holding a
+ * fingerprint and a count. A packet is hashed to one bucket per row:
+ * - if the bucket is empty or holds the fingerprint of the flowkey, the count
+ * is incremented;
+ * - otherwise the count decays, i.e., is decremented with probability
+ * `decay^(-count)`, so that a large count, most likely of an elephant flow,
+ * hardly ever decays. Once it reaches 0, the flowkey takes the bucket.
+ *
+ * The estimate of a flowkey is the largest count among the buckets holding its
+ * fingerprint, which never overestimates barring fingerprint collisions. The
+ * `topk` flowkeys with the largest estimates are kept in a TopKHeap.
+ *
+ * Decay probabilities are looked up in a table of 32-bit thresholds computed
+ * at construction, so that a decay is a comparison with a random integer.
+ * Counts beyond the table, whose probabilities round to 0, never decay.
+ *
+ * @tparam key_len  length of flowkey
+ * @tparam T        type of the counter
+ * @tparam hash_t   hashing class
+ * @tparam alloc_t  allocation policy of the buckets (see alloc.h)
+ */
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash,
+          typename alloc_t = Util::DefaultAlloc>
+class HeavyKeeper : public SketchBase<key_len, T> {
+private:
+  /**
+   * @brief A bucket, which is empty iff `count` is 0
+   *
+   */
+  struct Bucket {
+    uint32_t fp;
+    T count;
+  };
+
+  Util::Table<Bucket, 0, 0, alloc_t> buckets;
+  hash_t *hash_fns;
+  /**
+   * @brief `decay_thres[c]` is `decay^(-c) * 2^32`, rounded down
+   *
+   */
+  std::vector<uint32_t> decay_thres;
+  TopKHeap<key_len, T> heap;
+  std::mt19937 rng;
+
+  HeavyKeeper(const HeavyKeeper &) = delete;
+  HeavyKeeper(HeavyKeeper &&) = delete;
+  HeavyKeeper &operator=(HeavyKeeper) = delete;
+
+  /**
+   * @brief Nonzero fingerprint derived from the hash value of the first row
+   *
+   */
+  static uint32_t fingerprint(uint64_t hash_val) {
+    uint32_t fp = static_cast<uint32_t>(hash_val >> 32);
+    return fp ? fp : 1;
+  }
+
+public:
+  /**
+   * @brief Construct by specifying depth, width, # flowkeys to keep and the
+   * base of decay
+   *
+   * @param depth_  depth of the sketch
+   * @param width_  width of the sketch (rounded up to a prime)
+   * @param topk_   capacity of the heap
+   * @param decay_  base of the exponential decay, `> 1`
+   */
+  HeavyKeeper(int32_t depth_, int32_t width_, int32_t topk_,
+              double decay_ = 1.08);
+  /**
+   * @brief Release the pointer
+   *
+   */
+  ~HeavyKeeper();
+  /**
+   * @brief Update a flowkey with certain value
+   * @details Each unit of `val` is a vote that may decay the count of a
+   * colliding bucket.
+   */
+  void update(const FlowKey<key_len> &flowkey, T val) override;
+  /**
+   * @brief Query a flowkey
+   *
+   */
+  T query(const FlowKey<key_len> &flowkey) const override;
+  /**
+   * @brief Get the heavy hitters among flowkeys in the heap
+   *
+   * @param threshold A flowkey is a HH iff its estimate `>= threshold`
+   */
+  Data::Estimation<key_len, T> getHeavyHitter(double threshold) const override;
+  /**
+   * @brief Get the size of the sketch
+   *
+   */
+  size_t size() const override;
+  /**
+   * @brief Reset the sketch
+   *
+   */
+  void clear() override;
+};
+
+} // namespace OmniSketch::Sketch
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Sketch {
+
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+HeavyKeeper<key_len, T, hash_t, alloc_t>::HeavyKeeper(int32_t depth_,
+                                                      int32_t width_,
+                                                      int32_t topk_,
+                                                      double decay_)
+    : buckets(depth_, Util::NextPrime(width_)), hash_fns(new hash_t[depth_]),
+      heap(topk_), rng(std::random_device()()) {
+  if (!(decay_ > 1.0)) {
+    delete[] hash_fns;
+    throw std::invalid_argument(
+        "Invalid Argument: Base of decay should be greater than 1.");
+  }
+  // thresholds decrease geometrically until they round down to 0
+  for (double thres = 0x1p32 - 1; thres >= 1.0; thres /= decay_) {
+    decay_thres.push_back(static_cast<uint32_t>(thres));
+  }
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+HeavyKeeper<key_len, T, hash_t, alloc_t>::~HeavyKeeper() {
+  delete[] hash_fns;
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+void HeavyKeeper<key_len, T, hash_t, alloc_t>::update(
+    const FlowKey<key_len> &flowkey, T val) {
+  const uint32_t fp = fingerprint(hash_fns[0](flowkey));
+  T max_val = 0;
+  for (int32_t i = 0; i < buckets.rows(); ++i) {
+    Bucket &bucket = buckets[i][hash_fns[i](flowkey) % buckets.cols()];
+    if (bucket.count == 0 || bucket.fp == fp) {
+      bucket.fp = fp;
+      bucket.count += val;
+      max_val = std::max(max_val, bucket.count);
+      continue;
+    }
+    // decay one unit at a time until the bucket is taken or stops decaying
+    for (T left = val; left > 0; --left) {
+      if (static_cast<size_t>(bucket.count) >= decay_thres.size())
+        break;
+      if (rng() < decay_thres[bucket.count] && --bucket.count == 0) {
+        bucket.fp = fp;
+        bucket.count = left;
+        max_val = std::max(max_val, bucket.count);
+        break;
+      }
+    }
+  }
+  if (max_val > 0 && heap.admits(max_val)) {
+    heap.update(flowkey, max_val);
+  }
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+T HeavyKeeper<key_len, T, hash_t, alloc_t>::query(
+    const FlowKey<key_len> &flowkey) const {
+  const uint32_t fp = fingerprint(hash_fns[0](flowkey));
+  T max_val = 0;
+  for (int32_t i = 0; i < buckets.rows(); ++i) {
+    const Bucket &bucket = buckets[i][hash_fns[i](flowkey) % buckets.cols()];
+    if (bucket.fp == fp) {
+      max_val = std::max(max_val, bucket.count);
+    }
+  }
+  return max_val;
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+Data::Estimation<key_len, T>
+HeavyKeeper<key_len, T, hash_t, alloc_t>::getHeavyHitter(
+    double threshold) const {
+  // counts decay after a flowkey is last updated, so query them again
+  return heap.getHeavyHitter(
+      threshold, [this](const FlowKey<key_len> &flowkey) {
+        return query(flowkey);
+      });
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+size_t HeavyKeeper<key_len, T, hash_t, alloc_t>::size() const {
+  return sizeof(*this)                           // instance
+         + sizeof(hash_t) * buckets.rows()       // hashing class
+         + buckets.size()                        // buckets
+         + sizeof(uint32_t) * decay_thres.size() // decay table
+         + heap.size();                          // top-k heap
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+void HeavyKeeper<key_len, T, hash_t, alloc_t>::clear() {
+  buckets.clear();
+  heap.clear();
+}
+
+} // namespace OmniSketch::Sketch
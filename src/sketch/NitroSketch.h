@@ -0,0 +1,243 @@
+/**
+ * @file NitroSketch.h
+ * @author dromniscience (you@domain.com)
+ * @brief Implementation of NitroSketch
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <cmath>
+#include <common/sketch.h>
+#include <random>
+
+namespace OmniSketch::Sketch {
+/**
+ * @brief NitroSketch, a sampling front-end of row-based sketches
+ *
+ * @details Instead of updating every row of the underlying sketch, each of
+ * the `depth` row updates of a packet is sampled with probability `prob`,
+ * and a sampled update adds `val / prob` to that row only. Rather than
+ * tossing a coin per row, the gap to the next sampled row update is drawn
+ * from a geometric distribution, so that a packet with no sampled row costs a
+ * subtraction, and one with a sampled row costs a single row update most of
+ * the time. Hence at `prob = 1 / 16` and depth 5, less than a third of the
+ * packets touch the sketch at all.
+ *
+ * `prob` should be a power of 2, e.g., 1 / 16, so that the scale `1 / prob`
+ * is an exact integer. Increments are then unbiased, but their variance grows
+ * as `prob` shrinks, so `prob` trades accuracy for speed. Over Count Min
+ * Sketch, the minimum of the noisy rows tends to underestimate, whereas the
+ * median of Count Sketch does not. In the adaptive mode, the packet rate is
+ * measured from the timestamps passed to advance(), and `prob` is set to the
+ * largest power of 2 that keeps the expected row updates per second within
+ * the budget, but no less than the given `prob`. Since increments are scaled
+ * when they are made, changing `prob` does not bias the counters.
+ *
+ * @tparam key_len  length of flowkey
+ * @tparam T        type of the counter
+ * @tparam sketch_t underlying sketch, which should be constructible by
+ * `(depth, width)` and provide `updateRow()` and `getDepth()`, e.g., CMSketch
+ * and CountSketch
+ */
+template <int32_t key_len, typename T, typename sketch_t>
+class NitroSketch : public SketchBase<key_len, T> {
+private:
+  /**
+   * @brief # packets between two adaptations in the adaptive mode
+   *
+   */
+  static constexpr int64_t PERIOD = 1 << 14;
+
+  sketch_t sketch;
+  const int32_t depth;
+  const double min_prob;
+  const double budget;
+
+  double prob;
+  T scale;       // 1 / prob
+  double log_q;  // log(1 - prob)
+  int64_t skip;  // row updates to skip before the next sampled one
+  std::mt19937_64 rng;
+  std::uniform_real_distribution<double> unif;
+
+  int64_t num_packet; // since the last adaptation
+  int64_t last_time;  // timestamp of the last adaptation, -1 if none
+
+  NitroSketch(const NitroSketch &) = delete;
+  NitroSketch(NitroSketch &&) = delete;
+  NitroSketch &operator=(NitroSketch) = delete;
+
+  /**
+   * @brief # row updates to skip, i.e., a geometric variable counting the
+   * failures before a success
+   *
+   */
+  int64_t geometric() {
+    if (prob >= 1.0)
+      return 0;
+    // 1 - unif(rng) lies in (0, 1]
+    return static_cast<int64_t>(std::log(1.0 - unif(rng)) / log_q);
+  }
+  /**
+   * @brief Switch to a sampling probability
+   *
+   */
+  void setProb(double prob_);
+
+public:
+  /**
+   * @brief Construct by specifying the underlying sketch and the sampling
+   *
+   * @param depth_  depth of the underlying sketch
+   * @param width_  width of the underlying sketch
+   * @param prob_   sampling probability, a power of 2 in (0, 1]. The minimum
+   * one in the adaptive mode.
+   * @param budget_ if positive, the adaptive mode is on, with a budget of so
+   * many (in millions) row updates per second
+   */
+  NitroSketch(int32_t depth_, int32_t width_, double prob_,
+              double budget_ = 0.0);
+  /**
+   * @brief Update a flowkey with certain value
+   *
+   */
+  void update(const FlowKey<key_len> &flowkey, T val) override;
+  /**
+   * @brief Query a flowkey
+   *
+   */
+  T query(const FlowKey<key_len> &flowkey) const override;
+  /**
+   * @brief Query a batch of flowkeys
+   *
+   */
+  void queryMany(const FlowKey<key_len> *flowkeys, size_t num,
+                 std::vector<T> &result) const override;
+  /**
+   * @brief Tell the time (in microseconds) of the coming packet
+   * @details A non-overriding method. Only needed in the adaptive mode, where
+   * the packet rate is measured every `PERIOD` packets.
+   */
+  void advance(int64_t timestamp);
+  /**
+   * @brief Current sampling probability
+   *
+   */
+  double getProb() const { return prob; }
+  /**
+   * @brief Get the size of the sketch
+   *
+   */
+  size_t size() const override;
+  /**
+   * @brief Reset the sketch
+   *
+   */
+  void clear() override;
+};
+
+} // namespace OmniSketch::Sketch
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Sketch {
+
+template <int32_t key_len, typename T, typename sketch_t>
+NitroSketch<key_len, T, sketch_t>::NitroSketch(int32_t depth_, int32_t width_,
+                                               double prob_, double budget_)
+    : sketch(depth_, width_), depth(sketch.getDepth()), min_prob(prob_),
+      budget(budget_ * 1e6), rng(std::random_device()()), unif(0.0, 1.0),
+      num_packet(0), last_time(-1) {
+  int exp;
+  if (!(prob_ > 0.0 && prob_ <= 1.0) || std::frexp(prob_, &exp) != 0.5) {
+    throw std::invalid_argument(
+        "Invalid Argument: Sampling probability should be a power of 2 in "
+        "(0, 1].");
+  }
+  // the adaptive mode starts with full updates
+  setProb(budget > 0 ? 1.0 : prob_);
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+void NitroSketch<key_len, T, sketch_t>::setProb(double prob_) {
+  prob = prob_;
+  // exact, since `prob` is a power of 2
+  scale = static_cast<T>(std::ldexp(1.0, -std::ilogb(prob)));
+  log_q = std::log1p(-prob);
+  skip = geometric();
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+void NitroSketch<key_len, T, sketch_t>::update(const FlowKey<key_len> &flowkey,
+                                               T val) {
+  if (skip >= depth) {
+    // no row of this packet is sampled
+    skip -= depth;
+    return;
+  }
+  int64_t row = skip;
+  do {
+    sketch.updateRow(static_cast<int32_t>(row), flowkey, val * scale);
+    row += 1 + geometric();
+  } while (row < depth);
+  skip = row - depth;
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+T NitroSketch<key_len, T, sketch_t>::query(
+    const FlowKey<key_len> &flowkey) const {
+  return sketch.query(flowkey);
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+void NitroSketch<key_len, T, sketch_t>::queryMany(
+    const FlowKey<key_len> *flowkeys, size_t num,
+    std::vector<T> &result) const {
+  sketch.queryMany(flowkeys, num, result);
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+void NitroSketch<key_len, T, sketch_t>::advance(int64_t timestamp) {
+  if (budget <= 0)
+    return;
+  if (last_time < 0) {
+    last_time = timestamp;
+    return;
+  }
+  if (++num_packet < PERIOD || timestamp <= last_time)
+    return;
+  // row updates per second if every row were updated
+  const double demand = 1e6 * num_packet / (timestamp - last_time) * depth;
+  double next = 1.0;
+  while (next > min_prob && next * demand > budget) {
+    next /= 2;
+  }
+  next = std::max(next, min_prob);
+  if (next != prob) {
+    setProb(next);
+  }
+  num_packet = 0;
+  last_time = timestamp;
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+size_t NitroSketch<key_len, T, sketch_t>::size() const {
+  return sizeof(*this) - sizeof(sketch) // instance
+         + sketch.size();               // underlying sketch
+}
+
+template <int32_t key_len, typename T, typename sketch_t>
+void NitroSketch<key_len, T, sketch_t>::clear() {
+  sketch.clear();
+  num_packet = 0;
+  last_time = -1;
+  setProb(budget > 0 ? 1.0 : min_prob);
+}
+
+} // namespace OmniSketch::Sketch
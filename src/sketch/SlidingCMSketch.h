@@ -0,0 +1,203 @@
+/**
+ * @file SlidingCMSketch.h
+ * @author dromniscience (you@domain.com)
+ * @brief Implementation of Sliding-Window Count Min Sketch
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <common/hash.h>
+#include <common/sketch.h>
+#include <common/table.h>
+
+namespace OmniSketch::Sketch {
+/**
+ * @brief Count Min Sketch over a sliding time window
+ *
+ * @details The layout is that of CMSketch, except that each counter is a ring
+ * of `num_seg` segment counters, and the window of `window` microseconds is
+ * split into as many segments. An update adds to the segment of the current
+ * time, and a query sums up the segments of the window, i.e., the current
+ * segment and the `num_seg - 1` ones before it. Time is driven by advance(),
+ * typically with `Record::timestamp` before each update.
+ *
+ * Expiry is lazy: each counter remembers the last segment it was updated in,
+ * and the segments that have expired since are zeroed the next time it is
+ * updated. Hence an update costs O(1) amortized and never scans the sketch,
+ * while a query at any moment simply skips the expired segments. Segments of
+ * a counter are contiguous, so they share a cache line if `num_seg` is small.
+ *
+ * @tparam key_len  length of flowkey
+ * @tparam T        type of the counter
+ * @tparam hash_t   hashing class
+ * @tparam alloc_t  allocation policy of the counters (see alloc.h)
+ */
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash,
+          typename alloc_t = Util::DefaultAlloc>
+class SlidingCMSketch : public SketchBase<key_len, T> {
+private:
+  int32_t num_seg;
+  int64_t seg_len;
+  // counters, where `num_seg` consecutive ones make up a ring
+  Util::Table<T, 0, 0, alloc_t> counter;
+  // the last segment each ring was updated in
+  Util::Table<uint32_t, 0, 0, alloc_t> stamp;
+  hash_t *hash_fns;
+
+  bool started;
+  int64_t origin;
+  uint32_t cur; // current segment
+
+  SlidingCMSketch(const SlidingCMSketch &) = delete;
+  SlidingCMSketch(SlidingCMSketch &&) = delete;
+
+public:
+  /**
+   * @brief Construct by specifying depth, width and the window
+   *
+   * @param depth_    depth of the sketch
+   * @param width_    width of the sketch (rounded up to a prime)
+   * @param window_   length of the window (in microseconds), a multiple of
+   * `num_seg_`
+   * @param num_seg_  # segments in the window
+   */
+  SlidingCMSketch(int32_t depth_, int32_t width_, int64_t window_,
+                  int32_t num_seg_);
+  /**
+   * @brief Release the pointer
+   *
+   */
+  ~SlidingCMSketch();
+  /**
+   * @brief Move the clock to `timestamp` (in microseconds)
+   * @details The first call sets the start of the first segment. Time never
+   * goes back, so an earlier timestamp is ignored.
+   */
+  void advance(int64_t timestamp);
+  /**
+   * @brief Index of the current segment since the first advance()
+   *
+   */
+  uint32_t segment() const { return cur; }
+  /**
+   * @brief Update a flowkey with certain value at the current time
+   *
+   */
+  void update(const FlowKey<key_len> &flowkey, T val) override;
+  /**
+   * @brief Query a flowkey over the current window
+   *
+   */
+  T query(const FlowKey<key_len> &flowkey) const override;
+  /**
+   * @brief Get the size of the sketch
+   *
+   */
+  size_t size() const override;
+  /**
+   * @brief Reset the sketch, including the clock
+   *
+   */
+  void clear() override;
+};
+
+} // namespace OmniSketch::Sketch
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Sketch {
+
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+SlidingCMSketch<key_len, T, hash_t, alloc_t>::SlidingCMSketch(
+    int32_t depth_, int32_t width_, int64_t window_, int32_t num_seg_)
+    : num_seg(num_seg_), seg_len(num_seg_ > 0 ? window_ / num_seg_ : 0),
+      counter(depth_, Util::NextPrime(width_) * std::max(num_seg_, 1)),
+      stamp(depth_, Util::NextPrime(width_)), hash_fns(new hash_t[depth_]),
+      started(false), origin(0), cur(0) {
+  if (num_seg <= 0 || seg_len <= 0 || window_ % num_seg) {
+    delete[] hash_fns;
+    throw std::invalid_argument(
+        "Invalid Argument: Window should be a positive multiple of # "
+        "segments.");
+  }
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+SlidingCMSketch<key_len, T, hash_t, alloc_t>::~SlidingCMSketch() {
+  delete[] hash_fns;
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+void SlidingCMSketch<key_len, T, hash_t, alloc_t>::advance(int64_t timestamp) {
+  if (!started) {
+    started = true;
+    origin = timestamp;
+  }
+  if (timestamp > origin) {
+    cur = std::max(cur, static_cast<uint32_t>((timestamp - origin) / seg_len));
+  }
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+void SlidingCMSketch<key_len, T, hash_t, alloc_t>::update(
+    const FlowKey<key_len> &flowkey, T val) {
+  for (int32_t i = 0; i < stamp.rows(); ++i) {
+    int32_t index = hash_fns[i](flowkey) % stamp.cols();
+    T *ring = counter[i] + static_cast<size_t>(index) * num_seg;
+    uint32_t &last = stamp[i][index];
+    if (last != cur) {
+      // zero the segments that have expired since the last update
+      uint32_t num_expired =
+          std::min(cur - last, static_cast<uint32_t>(num_seg));
+      for (uint32_t seg = cur - num_expired + 1; seg != cur + 1; ++seg) {
+        ring[seg % num_seg] = 0;
+      }
+      last = cur;
+    }
+    ring[cur % num_seg] += val;
+  }
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+T SlidingCMSketch<key_len, T, hash_t, alloc_t>::query(
+    const FlowKey<key_len> &flowkey) const {
+  T min_val = std::numeric_limits<T>::max();
+  for (int32_t i = 0; i < stamp.rows(); ++i) {
+    int32_t index = hash_fns[i](flowkey) % stamp.cols();
+    const T *ring = counter[i] + static_cast<size_t>(index) * num_seg;
+    const uint32_t last = stamp[i][index];
+    // segments in the window but after `last` are empty
+    T sum = 0;
+    for (int64_t seg = std::max<int64_t>(int64_t(cur) - num_seg + 1, 0);
+         seg <= last; ++seg) {
+      sum += ring[seg % num_seg];
+    }
+    min_val = std::min(min_val, sum);
+  }
+  return min_val;
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+size_t SlidingCMSketch<key_len, T, hash_t, alloc_t>::size() const {
+  return sizeof(*this)                   // instance
+         + sizeof(hash_t) * stamp.rows() // hashing class
+         + counter.size()                // counter
+         + stamp.size();                 // last updated segments
+}
+
+template <int32_t key_len, typename T, typename hash_t, typename alloc_t>
+void SlidingCMSketch<key_len, T, hash_t, alloc_t>::clear() {
+  counter.clear();
+  stamp.clear();
+  started = false;
+  origin = 0;
+  cur = 0;
+}
+
+} // namespace OmniSketch::Sketch
@@ -0,0 +1,344 @@
+/**
+ * @file SpaceSaving.h
+ * @author dromniscience (you@domain.com)
+ * @brief Implementation of Space Saving
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <common/hash.h>
+#include <common/sketch.h>
+
+namespace OmniSketch::Sketch {
+/**
+ * @brief Space Saving on a Stream-Summary
+ *
+ * @details At most `capacity` flowkeys are monitored, each with a count and
+ * the maximum overestimation of the count. A monitored flowkey is simply
+ * incremented. An unmonitored one replaces a flowkey of the minimum count,
+ * inheriting that count as its error. Hence for any monitored flowkey,
+ * `count - error <= true value <= count`, and the true value of an
+ * unmonitored one is at most the minimum count.
+ *
+ * Counters are kept in a Stream-Summary: buckets of equal counts form a list
+ * sorted by count, and each bucket holds a list of its counters, so that the
+ * minimum is found at the head. Incrementing by 1 moves a counter to the next
+ * bucket or a new one after it, which is O(1). A larger increment walks past
+ * the buckets in between. Both lists are linked by indices into arrays
+ * allocated once, rather than by pointers to nodes on the heap.
+ *
+ * Flowkeys are located by an open-addressing table with linear probing, which
+ * holds counter indices and is at least twice as large as `capacity`.
+ *
+ * @tparam key_len  length of flowkey
+ * @tparam T        type of the counter
+ * @tparam hash_t   hashing class
+ */
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash>
+class SpaceSaving : public SketchBase<key_len, T> {
+private:
+  /**
+   * @brief Index of nothing
+   *
+   */
+  static constexpr int32_t NIL = -1;
+  /**
+   * @brief A monitored flowkey
+   *
+   */
+  struct Counter {
+    FlowKey<key_len> flowkey;
+    T count;
+    T error;
+    uint32_t home;  // home slot in the index
+    int32_t bucket; // the bucket it belongs to
+    int32_t prev;   // neighbours in the bucket
+    int32_t next;
+  };
+  /**
+   * @brief A non-empty bucket of counters with equal counts
+   *
+   */
+  struct Bucket {
+    T count;
+    int32_t head; // the first counter
+    int32_t prev; // neighbours in the list of buckets, by ascending count
+    int32_t next;
+  };
+
+  const int32_t capacity;
+  std::vector<Counter> counters; // counters in use are [0, size)
+  std::vector<Bucket> buckets;
+  std::vector<int32_t> free_buckets;
+  int32_t min_bucket; // head of the list of buckets
+
+  std::vector<int32_t> index; // slot -> counter, NIL if empty
+  uint32_t mask;              // # slots - 1
+  hash_t hash_fn;
+
+  SpaceSaving(const SpaceSaving &) = delete;
+  SpaceSaving(SpaceSaving &&) = delete;
+  SpaceSaving &operator=(SpaceSaving) = delete;
+
+  /**
+   * @brief Slot of a flowkey in the index, or the empty slot ending its probe
+   *
+   */
+  uint32_t locate(const FlowKey<key_len> &flowkey, uint32_t home) const;
+  /**
+   * @brief Remove the counter in a slot from the index
+   * @details Later counters in the same run are shifted backward, so that no
+   * tombstone is needed.
+   */
+  void erase(uint32_t slot);
+  /**
+   * @brief Detach a counter from its bucket, freeing the bucket if it becomes
+   * empty
+   * @return the bucket to search from for the new count: the detached bucket
+   * if it remains, or the one before it otherwise (NIL for the head)
+   */
+  int32_t detach(int32_t c);
+  /**
+   * @brief Attach a counter to the bucket of its count, creating one if none
+   *
+   * @param c     the counter
+   * @param after a bucket whose count is less than that of `c`, or NIL to
+   * search from the head
+   */
+  void attach(int32_t c, int32_t after);
+
+public:
+  /**
+   * @brief Construct by specifying the capacity
+   *
+   * @param capacity_ maximum # flowkeys monitored
+   */
+  SpaceSaving(int32_t capacity_);
+  /**
+   * @brief Update a flowkey with certain positive value
+   *
+   */
+  void update(const FlowKey<key_len> &flowkey, T val) override;
+  /**
+   * @brief Query a flowkey
+   * @details The count if it is monitored, and 0 otherwise.
+   */
+  T query(const FlowKey<key_len> &flowkey) const override;
+  /**
+   * @brief Get the heavy hitters among monitored flowkeys
+   *
+   * @param threshold A flowkey is a HH iff its count `>= threshold`
+   */
+  Data::Estimation<key_len, T> getHeavyHitter(double threshold) const override;
+  /**
+   * @brief Get the size of the sketch
+   *
+   */
+  size_t size() const override;
+  /**
+   * @brief Reset the sketch
+   *
+   */
+  void clear() override;
+};
+
+} // namespace OmniSketch::Sketch
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Sketch {
+
+template <int32_t key_len, typename T, typename hash_t>
+SpaceSaving<key_len, T, hash_t>::SpaceSaving(int32_t capacity_)
+    : capacity(capacity_), min_bucket(NIL) {
+  if (capacity <= 0) {
+    throw std::invalid_argument(
+        "Invalid Argument: Capacity should be positive.");
+  }
+  counters.reserve(capacity);
+  buckets.reserve(capacity);
+  free_buckets.reserve(capacity);
+  uint32_t num_slot = 1;
+  while (num_slot < 2 * static_cast<uint32_t>(capacity)) {
+    num_slot <<= 1;
+  }
+  index.assign(num_slot, NIL);
+  mask = num_slot - 1;
+}
+
+template <int32_t key_len, typename T, typename hash_t>
+uint32_t
+SpaceSaving<key_len, T, hash_t>::locate(const FlowKey<key_len> &flowkey,
+                                        uint32_t home) const {
+  uint32_t slot = home;
+  while (index[slot] != NIL && !(counters[index[slot]].flowkey == flowkey)) {
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+template <int32_t key_len, typename T, typename hash_t>
+void SpaceSaving<key_len, T, hash_t>::erase(uint32_t slot) {
+  uint32_t next = slot;
+  while (true) {
+    next = (next + 1) & mask;
+    if (index[next] == NIL)
+      break;
+    // a counter may move back to `slot` iff its home is not in (slot, next]
+    const uint32_t home = counters[index[next]].home;
+    if (((next - home) & mask) >= ((next - slot) & mask)) {
+      index[slot] = index[next];
+      slot = next;
+    }
+  }
+  index[slot] = NIL;
+}
+
+template <int32_t key_len, typename T, typename hash_t>
+int32_t SpaceSaving<key_len, T, hash_t>::detach(int32_t c) {
+  Counter &counter = counters[c];
+  const int32_t b = counter.bucket;
+  Bucket &bucket = buckets[b];
+  if (counter.prev != NIL) {
+    counters[counter.prev].next = counter.next;
+  } else {
+    bucket.head = counter.next;
+  }
+  if (counter.next != NIL) {
+    counters[counter.next].prev = counter.prev;
+  }
+  if (bucket.head != NIL)
+    return b;
+  // the bucket is empty now
+  if (bucket.prev != NIL) {
+    buckets[bucket.prev].next = bucket.next;
+  } else {
+    min_bucket = bucket.next;
+  }
+  if (bucket.next != NIL) {
+    buckets[bucket.next].prev = bucket.prev;
+  }
+  free_buckets.push_back(b);
+  return bucket.prev;
+}
+
+template <int32_t key_len, typename T, typename hash_t>
+void SpaceSaving<key_len, T, hash_t>::attach(int32_t c, int32_t after) {
+  Counter &counter = counters[c];
+  int32_t b = after == NIL ? min_bucket : buckets[after].next;
+  while (b != NIL && buckets[b].count < counter.count) {
+    after = b;
+    b = buckets[b].next;
+  }
+  if (b == NIL || buckets[b].count != counter.count) {
+    // a new bucket between `after` and `b`
+    int32_t nb;
+    if (!free_buckets.empty()) {
+      nb = free_buckets.back();
+      free_buckets.pop_back();
+    } else {
+      nb = buckets.size();
+      buckets.emplace_back();
+    }
+    buckets[nb] = {counter.count, NIL, after, b};
+    if (after != NIL) {
+      buckets[after].next = nb;
+    } else {
+      min_bucket = nb;
+    }
+    if (b != NIL) {
+      buckets[b].prev = nb;
+    }
+    b = nb;
+  }
+  Bucket &bucket = buckets[b];
+  counter.bucket = b;
+  counter.prev = NIL;
+  counter.next = bucket.head;
+  if (bucket.head != NIL) {
+    counters[bucket.head].prev = c;
+  }
+  bucket.head = c;
+}
+
+template <int32_t key_len, typename T, typename hash_t>
+void SpaceSaving<key_len, T, hash_t>::update(const FlowKey<key_len> &flowkey,
+                                             T val) {
+  if (val <= 0)
+    return;
+  const uint32_t home = hash_fn(flowkey) & mask;
+  uint32_t slot = locate(flowkey, home);
+  int32_t c = index[slot];
+  if (c != NIL) {
+    // monitored
+    int32_t after = detach(c);
+    counters[c].count += val;
+    attach(c, after);
+    return;
+  }
+  if (counters.size() < static_cast<size_t>(capacity)) {
+    // a free counter
+    c = counters.size();
+    counters.push_back({flowkey, val, 0, home, NIL, NIL, NIL});
+    index[slot] = c;
+    attach(c, NIL);
+    return;
+  }
+  // replace a counter of the minimum count
+  c = buckets[min_bucket].head;
+  Counter &counter = counters[c];
+  erase(locate(counter.flowkey, counter.home));
+  int32_t after = detach(c);
+  counter.flowkey = flowkey;
+  counter.error = counter.count;
+  counter.count += val;
+  counter.home = home;
+  // the slot may have moved back during erase()
+  index[locate(flowkey, home)] = c;
+  attach(c, after);
+}
+
+template <int32_t key_len, typename T, typename hash_t>
+T SpaceSaving<key_len, T, hash_t>::query(
+    const FlowKey<key_len> &flowkey) const {
+  const int32_t c = index[locate(flowkey, hash_fn(flowkey) & mask)];
+  return c != NIL ? counters[c].count : 0;
+}
+
+template <int32_t key_len, typename T, typename hash_t>
+Data::Estimation<key_len, T>
+SpaceSaving<key_len, T, hash_t>::getHeavyHitter(double threshold) const {
+  Data::Estimation<key_len, T> heavy_hitters;
+  for (const Counter &counter : counters) {
+    if (counter.count >= threshold) {
+      heavy_hitters[counter.flowkey] = counter.count;
+    }
+  }
+  return heavy_hitters;
+}
+
+template <int32_t key_len, typename T, typename hash_t>
+size_t SpaceSaving<key_len, T, hash_t>::size() const {
+  return sizeof(*this)                     // instance
+         + sizeof(Counter) * capacity      // counters
+         + sizeof(Bucket) * capacity       // buckets
+         + sizeof(int32_t) * capacity      // free buckets
+         + sizeof(int32_t) * index.size(); // index
+}
+
+template <int32_t key_len, typename T, typename hash_t>
+void SpaceSaving<key_len, T, hash_t>::clear() {
+  counters.clear();
+  buckets.clear();
+  free_buckets.clear();
+  min_bucket = NIL;
+  std::fill(index.begin(), index.end(), NIL);
+}
+
+} // namespace OmniSketch::Sketch
@@ -0,0 +1,148 @@
+/**
+ * @file BlockedBloomFilterTest.h
+ * @author dromniscience (you@domain.com)
+ * @brief Testing Blocked Bloom Filter
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <common/test.h>
+#include <sketch/BlockedBloomFilter.h>
+#include <sketch/BloomFilter.h>
+
+#define BBF_PARA_PATH "BBF.para"
+#define BBF_TEST_PATH "BBF.test"
+#define BBF_DATA_PATH "BBF.data"
+
+namespace OmniSketch::Test {
+/**
+ * @brief Testing class for Blocked Bloom Filter
+ *
+ */
+template <int32_t key_len, typename hash_t = Hash::AwareHash>
+class BlockedBloomFilterTest : public TestBase<key_len> {
+  using TestBase<key_len>::config_file;
+
+public:
+  /**
+   * @brief Constructor
+   * @details Names from left to right are
+   * - show name
+   * - config file
+   * - path to the node that contains metrics of interest (concatenated with
+   * '.')
+   */
+  BlockedBloomFilterTest(const std::string_view config_file)
+      : TestBase<key_len>("Blocked Bloom Filter", config_file,
+                          BBF_TEST_PATH) {}
+
+  /**
+   * @brief Test Blocked Bloom Filter
+   * @details An overriden method
+   */
+  void runTest() override;
+};
+
+} // namespace OmniSketch::Test
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Test {
+
+template <int32_t key_len, typename hash_t>
+void BlockedBloomFilterTest<key_len, hash_t>::runTest() {
+  // for convenience only
+  using StreamData = Data::StreamData<key_len>;
+
+  // parse config
+  int32_t nbit, nhash;   // sketch config
+  std::string data_file; // data config
+  toml::array arr;       // shortly we will convert it to format
+
+  Util::ConfigParser parser(config_file);
+  if (!parser.succeed()) {
+    return;
+  }
+  parser.setWorkingNode(BBF_PARA_PATH);
+  if (!parser.parseConfig(nbit, "num_bits"))
+    return;
+  if (!parser.parseConfig(nhash, "num_hash"))
+    return;
+  // # hash functions of the classic Bloom Filter, which is optional
+  int32_t baseline_hash = 0;
+  parser.parseConfig(baseline_hash, "baseline_hash", false);
+
+  parser.setWorkingNode(BBF_DATA_PATH);
+  if (!parser.parseConfig(data_file, "data"))
+    return;
+  if (!parser.parseConfig(arr, "format"))
+    return;
+  Data::DataFormat format(arr); // conver from toml::array to Data::DataFormat
+
+  double sample;
+  parser.setWorkingNode(BBF_TEST_PATH);
+  if (!parser.parseConfig(sample, "sample"))
+    return;
+  if (sample <= 0. || sample > 1.) {
+    throw std::out_of_range(
+        "Sample Rate Out Of Range: Should be in (0,1], but got " +
+        std::to_string(sample) + " instead.");
+  }
+
+  // prepare data
+  StreamData data(data_file, format);
+  if (!data.succeed())
+    return;
+  auto data_ptr = data.diff(static_cast<std::size_t>(sample * data.size()));
+  Data::GndTruth<key_len> gnd_truth, sample_truth;
+  gnd_truth.getGroundTruth(data.begin(), data.end(),
+                           Data::CntMethod::InPacket); // all flows
+  sample_truth.getGroundTruth(
+      data.begin(), data_ptr,
+      Data::CntMethod::InPacket); // first $sample fraction of records
+  fmt::print("DataSet: {:d} records with {:d} keys ({})\n", data.size(),
+             gnd_truth.size(), data_file);
+
+  // blocked bloom filter
+  auto blocked = new Sketch::BlockedBloomFilter<key_len, hash_t>(nbit, nhash);
+  const int32_t num_bits = blocked->numBits();
+  std::unique_ptr<Sketch::SketchBase<key_len>> ptr(blocked);
+
+  this->testInsert(ptr, data.begin(),
+                   data_ptr); // metrics of interest are in config file
+  this->testLookup(ptr, gnd_truth,
+                   sample_truth); // metrics of interest are in config file
+  this->testSize(ptr);
+  this->show();
+
+  // classic bloom filter with the same number of bits, so that FPR and
+  // throughput of the two can be compared side by side
+  if (baseline_hash > 0) {
+    TestBase<key_len> baseline("Bloom Filter", config_file, BBF_TEST_PATH);
+    ptr.reset(
+        new Sketch::BloomFilter<key_len, hash_t>(num_bits, baseline_hash));
+    baseline.testInsert(ptr, data.begin(), data_ptr);
+    baseline.testLookup(ptr, gnd_truth, sample_truth);
+    baseline.testSize(ptr);
+    baseline.show();
+  }
+
+  return;
+}
+
+} // namespace OmniSketch::Test
+
+#undef BBF_PARA_PATH
+#undef BBF_TEST_PATH
+#undef BBF_DATA_PATH
+
+// Driver instance:
+//      AUTHOR: dromniscience
+//      CONFIG: sketch_config.toml  # with respect to the `src/` directory
+//    TEMPLATE: <13, Hash::AwareHash>
@@ -19,11 +19,26 @@ namespace OmniSketch::Test {
 /**
  * @brief Testing class for Bloom Filter
  *
+ * @tparam NumHash  # hash functions if fixed at compile time; 0 otherwise
+ * @tparam NumBits  # bits if fixed at compile time; 0 otherwise
  */
-template <int32_t key_len, typename hash_t = Hash::AwareHash>
+template <int32_t key_len, typename hash_t = Hash::AwareHash,
+          int32_t NumHash = 0, int32_t NumBits = 0>
 class BloomFilterTest : public TestBase<key_len> {
   using TestBase<key_len>::config_file;
+  /**
+   * @brief The filter with `H` hash functions and `B` bits fixed, or given on
+   * construction if both are 0
+   */
+  template <int32_t H, int32_t B>
+  using Fixed = Sketch::BloomFilter<key_len, hash_t, H, B>;
 
+  /**
+   * @brief Make a Bloom Filter, whose parameters are fixed in the template if
+   * the config agrees with them, and given on construction otherwise
+   */
+  std::unique_ptr<Sketch::SketchBase<key_len>> makeSketch(int32_t nbit,
+                                                          int32_t nhash) const;
 public:
   /**
    * @brief Constructor
@@ -53,8 +68,18 @@ public:
 
 namespace OmniSketch::Test {
 
-template <int32_t key_len, typename hash_t>
-void BloomFilterTest<key_len, hash_t>::runTest() {
+template <int32_t key_len, typename hash_t, int32_t NumHash, int32_t NumBits>
+std::unique_ptr<Sketch::SketchBase<key_len>>
+BloomFilterTest<key_len, hash_t, NumHash, NumBits>::makeSketch(
+    int32_t nbit, int32_t nhash) const {
+  return makeFixedSketch<Sketch::SketchBase<key_len>, Fixed, NumHash, NumBits>(
+      nhash, nbit, [&](auto sketch, int32_t b) {
+        return std::make_unique<typename decltype(sketch)::type>(b, nhash);
+      });
+}
+
+template <int32_t key_len, typename hash_t, int32_t NumHash, int32_t NumBits>
+void BloomFilterTest<key_len, hash_t, NumHash, NumBits>::runTest() {
   /**
    * @brief shorthand for convenience
    *
@@ -109,8 +134,7 @@ void BloomFilterTest<key_len, hash_t>::runTest() {
   ///   Prepare sketch and data
   ///
   /// Step i. Initialize a sketch
-  std::unique_ptr<Sketch::SketchBase<key_len>> ptr(
-      new Sketch::BloomFilter<key_len, hash_t>(nbit, nhash));
+  std::unique_ptr<Sketch::SketchBase<key_len>> ptr = makeSketch(nbit, nhash);
   /// remember that the left ptr must point to the base class in order to call
   /// the methods in it
 
@@ -160,4 +184,4 @@ void BloomFilterTest<key_len, hash_t>::runTest() {
 // Driver instance:
 //      AUTHOR: dromniscience
 //      CONFIG: sketch_config.toml  # with respect to the `src/` directory
-//    TEMPLATE: <13, Hash::AwareHash>
+//    TEMPLATE: <13, Hash::AwareHash, ${BF.para.num_hash}, ${NextPrime(BF.para.num_bits)}>
@@ -9,6 +9,10 @@
 #include <common/test.h>
 #include <sketch/CHCMSketch.h>
 
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
 #define CHCM_PARA_PATH "CM.para"
 #define CHCM_TEST_PATH "CM.test"
 #define CHCM_DATA_PATH "CM.data"
@@ -113,14 +117,35 @@ void CHCMSketchTest<key_len, no_layer, T, hash_t>::runTest() {
   if (!method.compare("InPacket")) {
     cnt_method = Data::InPacket;
   }
+  /// Step viii. [Optional] Parse the solver of CH and the number of threads
+  /// to benchmark decoding with.
+  std::string solver_name = "LSCG";
+  size_t qr_threshold = 0;
+  std::vector<int32_t> decode_threads;
+  parser.setWorkingNode(CHCM_CH_PATH);
+  parser.parseConfig(solver_name, "solver", false);
+  parser.parseConfig(qr_threshold, "qr_threshold", false);
+  parser.parseConfig(decode_threads, "decode_threads", false);
+  Sketch::DecodeSolver solver = Sketch::LSCG;
+  if (!solver_name.compare("CGLS")) {
+    solver = Sketch::CGLS;
+  } else if (!solver_name.compare("QR")) {
+    solver = Sketch::QR;
+  } else if (solver_name.compare("LSCG")) {
+    LOG(ERROR, fmt::format("Unknown solver of CH: {} (expected \"LSCG\", "
+                           "\"CGLS\" or \"QR\")",
+                           solver_name));
+    return;
+  }
 
   /// Part II.
   ///   Prepare sketch and data
   ///
   /// Step i. Initialize a sketch
-  std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr(
-      new Sketch::CHCMSketch<key_len, no_layer, T, hash_t>(
-          depth, width, cnt_no_ratio, width_cnt, no_hash));
+  auto sketch = new Sketch::CHCMSketch<key_len, no_layer, T, hash_t>(
+      depth, width, cnt_no_ratio, width_cnt, no_hash);
+  sketch->setSolver(solver, qr_threshold);
+  std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr(sketch);
   /// remember that the left ptr must point to the base class in order to call
   /// the methods in it
 
@@ -146,6 +171,19 @@ void CHCMSketchTest<key_len, no_layer, T, hash_t>::runTest() {
   this->testSize(ptr);
   ///        3. show metrics
   this->show();
+  ///        4. [optional] decode from scratch with different # threads
+  for (int32_t threads : decode_threads) {
+#if defined(_OPENMP)
+    omp_set_num_threads(threads);
+#endif
+    Eigen::setNbThreads(threads);
+    std::vector<double> time = sketch->redecode();
+    fmt::print("Decode ({}, {:d} threads):", solver_name, threads);
+    for (size_t i = 0; i < time.size(); ++i) {
+      fmt::print(" layer {:d} {:.6f}s", i, time[i]);
+    }
+    fmt::print("\n");
+  }
 
   return;
 }
@@ -8,22 +8,57 @@
  */
 #pragma once
 
+#include <common/perf.h>
 #include <common/test.h>
 #include <sketch/CMSketch.h>
 
 #define CM_PARA_PATH "CM.para"
 #define CM_TEST_PATH "CM.test"
 #define CM_DATA_PATH "CM.data"
+#define CM_ALLOC_PATH "CM.alloc"
+#define CM_EPOCH_PATH "CM.epoch"
 
 namespace OmniSketch::Test {
 
 /**
  * @brief Testing class for Count Min Sketch
  *
+ * @tparam cell_t  type of the cell holding a counter, e.g., `uint16_t` to
+ * test narrow saturating cells (then scale `width` to compare in equal size)
  */
-template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash>
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash,
+          int32_t Depth = 0, int32_t Width = 0, typename cell_t = T>
 class CMSketchTest : public TestBase<key_len, T> {
   using TestBase<key_len, T>::config_file;
+  /**
+   * @brief The sketch with dimensions `D * W` fixed, or given on construction
+   * if both are 0
+   */
+  template <int32_t D, int32_t W>
+  using Fixed = Sketch::CMSketch<key_len, T, hash_t, D, W, cell_t>;
+
+  /**
+   * @brief Make a Count Min Sketch, whose dimensions are fixed in the template
+   * if the config agrees with them, and given on construction otherwise
+   */
+  std::unique_ptr<Sketch::SketchBase<key_len, T>>
+  makeSketch(int32_t depth, int32_t width, int32_t topk) const;
+  /**
+   * @brief Replay the data into a fresh Count Min Sketch whose counters are
+   * allocated by `alloc_t`
+   * @return update rate in Mpps, and # dTLB misses (0 if not available)
+   */
+  template <typename alloc_t>
+  std::pair<double, uint64_t> replay(int32_t depth, int32_t width,
+                                     const Data::StreamData<key_len> &data,
+                                     Data::CntMethod cnt_method);
+  /**
+   * @brief Compare update rates and dTLB misses of plain, cache-aligned and
+   * huge page allocations
+   */
+  void compareAlloc(int32_t depth, int32_t width,
+                    const Data::StreamData<key_len> &data,
+                    Data::CntMethod cnt_method);
 
 public:
   /**
@@ -54,8 +89,74 @@ public:
 
 namespace OmniSketch::Test {
 
-template <int32_t key_len, typename T, typename hash_t>
-void CMSketchTest<key_len, T, hash_t>::runTest() {
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, typename cell_t>
+std::unique_ptr<Sketch::SketchBase<key_len, T>>
+CMSketchTest<key_len, T, hash_t, Depth, Width, cell_t>::makeSketch(
+    int32_t depth, int32_t width, int32_t topk) const {
+  return makeFixedSketch<Sketch::SketchBase<key_len, T>, Fixed, Depth, Width>(
+      depth, width, [&](auto sketch, int32_t w) {
+        return std::make_unique<typename decltype(sketch)::type>(depth, w,
+                                                                 topk);
+      });
+}
+
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, typename cell_t>
+template <typename alloc_t>
+std::pair<double, uint64_t>
+CMSketchTest<key_len, T, hash_t, Depth, Width, cell_t>::replay(
+    int32_t depth, int32_t width, const Data::StreamData<key_len> &data,
+    Data::CntMethod cnt_method) {
+  std::unique_ptr<Sketch::CMSketch<key_len, T, hash_t, 0, 0, cell_t, alloc_t>>
+      sketch(new Sketch::CMSketch<key_len, T, hash_t, 0, 0, cell_t, alloc_t>(
+          depth, width));
+  Util::PerfCounter load_miss(Util::PerfCounter::DTLB_LOAD_MISS);
+  Util::PerfCounter store_miss(Util::PerfCounter::DTLB_STORE_MISS);
+  load_miss.start();
+  store_miss.start();
+  auto tick = std::chrono::steady_clock::now();
+  for (const auto &record : data) {
+    sketch->update(record.flowkey,
+                   cnt_method == Data::InLength ? record.length : 1);
+  }
+  double sec =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - tick)
+          .count();
+  load_miss.stop();
+  store_miss.stop();
+  return {data.size() / sec / 1e6, load_miss.value() + store_miss.value()};
+}
+
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, typename cell_t>
+void CMSketchTest<key_len, T, hash_t, Depth, Width, cell_t>::compareAlloc(
+    int32_t depth, int32_t width, const Data::StreamData<key_len> &data,
+    Data::CntMethod cnt_method) {
+  const std::pair<const char *, std::pair<double, uint64_t>> result[] = {
+      {"new[]", replay<Util::DefaultAlloc>(depth, width, data, cnt_method)},
+      {"64-byte aligned",
+       replay<Util::AlignedAlloc<>>(depth, width, data, cnt_method)},
+      {"huge pages",
+       replay<Util::HugePageAlloc<>>(depth, width, data, cnt_method)}};
+  const bool counted = Util::PerfCounter(Util::PerfCounter::DTLB_LOAD_MISS)
+                           .valid();
+  fmt::print("Allocation of {:d} * {:d} counters ({:.1f} MB):\n", depth,
+             width, sizeof(cell_t) * depth * static_cast<double>(width) / 1e6);
+  for (const auto &[name, res] : result) {
+    if (counted) {
+      fmt::print("  {:<16}update {:.2f} Mpps, {:d} dTLB misses\n", name,
+                 res.first, res.second);
+    } else {
+      fmt::print("  {:<16}update {:.2f} Mpps, dTLB misses not available\n",
+                 name, res.first);
+    }
+  }
+}
+
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, typename cell_t>
+void CMSketchTest<key_len, T, hash_t, Depth, Width, cell_t>::runTest() {
   /**
    * @brief shorthand for convenience
    *
@@ -68,6 +169,7 @@ void CMSketchTest<key_len, T, hash_t>::runTest() {
   /// Step i.  First we list the variables to parse, namely:
   ///
   int32_t depth, width;  // sketch config
+  int32_t topk = 0;      // [optional] top-k tracking
   std::string data_file; // data config
   toml::array arr;       // shortly we will convert it to format
   /// Step ii. Open the config file
@@ -83,6 +185,19 @@ void CMSketchTest<key_len, T, hash_t>::runTest() {
     return;
   if (!parser.parseConfig(width, "width"))
     return;
+  parser.parseConfig(topk, "topk", false);
+  // whether to benchmark allocation policies on a large sketch, optional
+  bool compare_alloc = false;
+  int32_t alloc_width = width;
+  parser.setWorkingNode(CM_ALLOC_PATH);
+  parser.parseConfig(compare_alloc, "compare", false);
+  parser.parseConfig(alloc_width, "width", false);
+  // time windows (in microseconds), optional
+  size_t window = 0, slide = 0;
+  parser.setWorkingNode(CM_EPOCH_PATH);
+  parser.parseConfig(window, "window", false);
+  slide = window;
+  parser.parseConfig(slide, "slide", false);
   /// Step v. Move to the data node
   parser.setWorkingNode(CM_DATA_PATH);
   /// Step vi. Parse data and format
@@ -101,13 +216,19 @@ void CMSketchTest<key_len, T, hash_t>::runTest() {
   if (!method.compare("InPacket")) {
     cnt_method = Data::InPacket;
   }
+  /// Step viii. Parse heavy hitter settings if top-k is tracked
+  double num_heavy_hitter = 0.0;
+  Data::HXMethod hx_method = Data::TopK;
+  if (topk > 0 &&
+      !this->parseHeavyHitter(parser, num_heavy_hitter, hx_method))
+    return;
 
   /// Part II.
   ///   Prepare sketch and data
   ///
   /// Step i. Initialize a sketch
-  std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr(
-      new Sketch::CMSketch<key_len, T, hash_t>(depth, width));
+  std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr =
+      makeSketch(depth, width, topk);
   /// remember that the left ptr must point to the base class in order to call
   /// the methods in it
 
@@ -129,10 +250,28 @@ void CMSketchTest<key_len, T, hash_t>::runTest() {
                    cnt_method); // metrics of interest are in config file
   ///        2. query for all the flowkeys
   this->testQuery(ptr, gnd_truth); // metrics of interest are in config file
-  ///        3. size
+  ///        3. [optional] heavy hitters from the tracked top-k
+  if (topk > 0) {
+    this->testHeavyHitter(ptr, gnd_truth, num_heavy_hitter, hx_method);
+  }
+  ///        4. [optional] measure window by window
+  if (window > 0) {
+    // three sketches for each open window, rotated across epochs
+    std::vector<std::unique_ptr<Sketch::SketchBase<key_len, T>>> ptrs;
+    for (size_t i = 0; slide > 0 && i < 3 * (window / slide); ++i) {
+      ptrs.push_back(makeSketch(depth, width, 0));
+    }
+    this->testEpoch(std::move(ptrs), data.begin(), data.end(), cnt_method,
+                    window, slide);
+  }
+  ///        5. size
   this->testSize(ptr);
-  ///        3. show metrics
+  ///        6. show metrics
   this->show();
+  ///        7. [optional] compare allocation policies
+  if (compare_alloc) {
+    compareAlloc(depth, alloc_width, data, cnt_method);
+  }
 
   return;
 }
@@ -142,8 +281,10 @@ void CMSketchTest<key_len, T, hash_t>::runTest() {
 #undef CM_PARA_PATH
 #undef CM_TEST_PATH
 #undef CM_DATA_PATH
+#undef CM_ALLOC_PATH
+#undef CM_EPOCH_PATH
 
 // Driver instance:
 //      AUTHOR: dromniscience
 //      CONFIG: sketch_config.toml  # with respect to the `src/` directory
-//    TEMPLATE: <13, int32_t, Hash::AwareHash>
\ No newline at end of file
+//    TEMPLATE: <13, int32_t, Hash::AwareHash, ${CM.para.depth}, ${NextPrime(CM.para.width)}>
\ No newline at end of file
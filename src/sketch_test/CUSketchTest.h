@@ -15,16 +15,51 @@
 #define CU_PARA_PATH "CM.para"
 #define CU_TEST_PATH "CM.test"
 #define CU_DATA_PATH "CM.data"
+#define CU_CU_PATH "CM.cu"
 
 namespace OmniSketch::Test {
 
 /**
  * @brief Testing class for CU Sketch
  *
+ * @tparam cell_t  type of the cell holding a counter, e.g., `uint16_t` to
+ * test narrow saturating cells (then scale `width` to compare in equal size)
  */
-template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash>
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash,
+          int32_t Depth = 0, int32_t Width = 0, typename cell_t = T>
 class CUSketchTest : public TestBase<key_len, T> {
   using TestBase<key_len, T>::config_file;
+  /**
+   * @brief The sketch with dimensions `D * W` fixed, or given on construction
+   * if both are 0
+   */
+  template <int32_t D, int32_t W>
+  using Fixed = Sketch::CUSketch<key_len, T, hash_t, D, W, false, cell_t>;
+
+  /**
+   * @brief Make a CU Sketch, whose dimensions are fixed in the template if the
+   * config agrees with them, and given on construction otherwise
+   */
+  std::unique_ptr<Sketch::SketchBase<key_len, T>>
+  makeSketch(int32_t depth, int32_t width, int32_t topk) const;
+  /**
+   * @brief Replay the data into a fresh CU Sketch
+   * @return update rate in Mpps
+   */
+  template <int32_t D, bool V>
+  double replay(int32_t depth, int32_t width,
+                const Data::StreamData<key_len> &data,
+                Data::CntMethod cnt_method);
+  /**
+   * @brief Compare update rates of runtime depth, fixed depth and fixed depth
+   * with AVX2
+   * @details Instantiated for each depth in `[D, 8]` so that `depth` can be
+   * matched with a compile-time constant.
+   */
+  template <int32_t D = 1>
+  void compareFixedDepth(int32_t depth, int32_t width,
+                         const Data::StreamData<key_len> &data,
+                         Data::CntMethod cnt_method);
 
 public:
   /**
@@ -55,8 +90,64 @@ public:
 
 namespace OmniSketch::Test {
 
-template <int32_t key_len, typename T, typename hash_t>
-void CUSketchTest<key_len, T, hash_t>::runTest() {
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, typename cell_t>
+std::unique_ptr<Sketch::SketchBase<key_len, T>>
+CUSketchTest<key_len, T, hash_t, Depth, Width, cell_t>::makeSketch(
+    int32_t depth, int32_t width, int32_t topk) const {
+  return makeFixedSketch<Sketch::SketchBase<key_len, T>, Fixed, Depth, Width>(
+      depth, width, [&](auto sketch, int32_t w) {
+        return std::make_unique<typename decltype(sketch)::type>(depth, w,
+                                                                 topk);
+      });
+}
+
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, typename cell_t>
+template <int32_t D, bool V>
+double CUSketchTest<key_len, T, hash_t, Depth, Width, cell_t>::replay(
+    int32_t depth, int32_t width, const Data::StreamData<key_len> &data,
+    Data::CntMethod cnt_method) {
+  Sketch::CUSketch<key_len, T, hash_t, D, 0, V> sketch(depth, width);
+  auto tick = std::chrono::steady_clock::now();
+  for (const auto &record : data) {
+    sketch.update(record.flowkey,
+                  cnt_method == Data::InLength ? record.length : 1);
+  }
+  double sec =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - tick)
+          .count();
+  return data.size() / sec / 1e6;
+}
+
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, typename cell_t>
+template <int32_t D>
+void CUSketchTest<key_len, T, hash_t, Depth, Width, cell_t>::compareFixedDepth(
+    int32_t depth, int32_t width, const Data::StreamData<key_len> &data,
+    Data::CntMethod cnt_method) {
+  if constexpr (D > 8) {
+    fmt::print("Fixed depth: only depth in [1, 8] is compared.\n");
+  } else if (depth != D) {
+    compareFixedDepth<D + 1>(depth, width, data, cnt_method);
+  } else {
+    double runtime = replay<0, false>(depth, width, data, cnt_method);
+    double fixed = replay<D, false>(depth, width, data, cnt_method);
+    double vectorized = replay<D, true>(depth, width, data, cnt_method);
+#if defined(__AVX2__)
+    const char *note = "";
+#else
+    const char *note = " (AVX2 not enabled at compile time)";
+#endif
+    fmt::print("Update: runtime depth {:.2f} Mpps, fixed depth {:.2f} Mpps, "
+               "fixed depth with AVX2 {:.2f} Mpps{}\n",
+               runtime, fixed, vectorized, note);
+  }
+}
+
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width, typename cell_t>
+void CUSketchTest<key_len, T, hash_t, Depth, Width, cell_t>::runTest() {
   /**
    * @brief shorthand for convenience
    *
@@ -69,6 +160,7 @@ void CUSketchTest<key_len, T, hash_t>::runTest() {
   /// Step i.  First we list the variables to parse, namely:
   ///
   int32_t depth, width;  // sketch config
+  int32_t topk = 0;      // [optional] top-k tracking
   std::string data_file; // data config
   toml::array arr;       // shortly we will convert it to format
   /// Step ii. Open the config file
@@ -84,6 +176,11 @@ void CUSketchTest<key_len, T, hash_t>::runTest() {
     return;
   if (!parser.parseConfig(width, "width"))
     return;
+  parser.parseConfig(topk, "topk", false);
+  // whether to benchmark update with depth fixed at compile time, optional
+  bool fixed_depth = false;
+  parser.setWorkingNode(CU_CU_PATH);
+  parser.parseConfig(fixed_depth, "fixed_depth", false);
   /// Step v. Move to the data node
   parser.setWorkingNode(CU_DATA_PATH);
   /// Step vi. Parse data and format
@@ -102,13 +199,19 @@ void CUSketchTest<key_len, T, hash_t>::runTest() {
   if (!method.compare("InPacket")) {
     cnt_method = Data::InPacket;
   }
+  /// Step viii. Parse heavy hitter settings if top-k is tracked
+  double num_heavy_hitter = 0.0;
+  Data::HXMethod hx_method = Data::TopK;
+  if (topk > 0 &&
+      !this->parseHeavyHitter(parser, num_heavy_hitter, hx_method))
+    return;
 
   /// Part II.
   ///   Prepare sketch and data
   ///
   /// Step i. Initialize a sketch
-  std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr(
-      new Sketch::CUSketch<key_len, T, hash_t>(depth, width));
+  std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr =
+      makeSketch(depth, width, topk);
   /// remember that the left ptr must point to the base class in order to call
   /// the methods in it
 
@@ -130,10 +233,18 @@ void CUSketchTest<key_len, T, hash_t>::runTest() {
                    cnt_method); // metrics of interest are in config file
   ///        2. query for all the flowkeys
   this->testQuery(ptr, gnd_truth); // metrics of interest are in config file
+  ///        3. [optional] heavy hitters from the tracked top-k
+  if (topk > 0) {
+    this->testHeavyHitter(ptr, gnd_truth, num_heavy_hitter, hx_method);
+  }
   ///        3. size
   this->testSize(ptr);
   ///        3. show metrics
   this->show();
+  ///        4. [optional] compare with depth fixed at compile time
+  if (fixed_depth) {
+    compareFixedDepth(depth, width, data, cnt_method);
+  }
 
   return;
 }
@@ -143,8 +254,9 @@ void CUSketchTest<key_len, T, hash_t>::runTest() {
 #undef CU_PARA_PATH
 #undef CU_TEST_PATH
 #undef CU_DATA_PATH
+#undef CU_CU_PATH
 
 // Driver instance:
 //      AUTHOR: dromniscience
 //      CONFIG: sketch_config.toml  # with respect to the `src/` directory
-//    TEMPLATE: <13, int32_t, Hash::AwareHash>
\ No newline at end of file
+//    TEMPLATE: <13, int32_t, Hash::AwareHash, ${CM.para.depth}, ${NextPrime(CM.para.width)}>
\ No newline at end of file
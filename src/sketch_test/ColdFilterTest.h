@@ -0,0 +1,279 @@
+/**
+ * @file ColdFilterTest.h
+ * @author dromniscience (you@domain.com)
+ * @brief Test Cold Filter
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <common/test.h>
+#include <sketch/CHCMSketch.h>
+#include <sketch/CMSketch.h>
+#include <sketch/ColdFilter.h>
+#include <sketch/FlowRadar.h>
+#include <sketch/HashPipe.h>
+
+#define CF_PARA_PATH "CF.para"
+#define CF_TEST_PATH "CF.test"
+#define CF_DATA_PATH "CF.data"
+
+namespace OmniSketch::Test {
+
+/**
+ * @brief Testing class for Cold Filter
+ *
+ * @details The back-end is one of
+ * - "CM": Count Min Sketch, configured by [CM.para]
+ * - "CHCM": CH-optimized Count Min Sketch, configured by [CM.para] and [CM.ch]
+ * - "HP": Hash Pipe, configured by [HP.para]
+ * - "FR": Flow Radar, configured by [FlowRadar.para]
+ *
+ * which is tested with the metrics that apply to it. Optionally, the same
+ * back-end without the filter is tested as well, for comparison. It is
+ * scaled to the memory of the filter and its back-end together.
+ *
+ * @tparam ch_layer # layers of CH, if the back-end is "CHCM"
+ */
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash,
+          int32_t ch_layer = 2>
+class ColdFilterTest : public TestBase<key_len, T> {
+  using TestBase<key_len, T>::config_file;
+
+  /**
+   * @brief Make the back-end as configured in its own section
+   *
+   * @param scale factor applied to the widths (or # bits and # cells of Flow
+   * Radar) in the config, to match the memory of another sketch
+   * @return `nullptr` on failure
+   */
+  std::unique_ptr<Sketch::SketchBase<key_len, T>>
+  makeBackend(const std::string &name, double scale = 1.0) const;
+
+public:
+  /**
+   * @brief Constructor
+   * @details Names from left to right are
+   * - show name
+   * - config file
+   * - path to the node that contains metrics of interest (concatenated with
+   * '.')
+   */
+  ColdFilterTest(const std::string_view config_file)
+      : TestBase<key_len, T>("Cold Filter", config_file, CF_TEST_PATH) {}
+
+  /**
+   * @brief Test Cold Filter
+   * @details An overriden method
+   */
+  void runTest() override;
+};
+
+} // namespace OmniSketch::Test
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Test {
+
+template <int32_t key_len, typename T, typename hash_t, int32_t ch_layer>
+std::unique_ptr<Sketch::SketchBase<key_len, T>>
+ColdFilterTest<key_len, T, hash_t, ch_layer>::makeBackend(
+    const std::string &name, double scale) const {
+  Util::ConfigParser parser(config_file);
+  if (!parser.succeed()) {
+    return nullptr;
+  }
+  auto scaled = [scale](int32_t val) {
+    return std::max(static_cast<int32_t>(val * scale), 1);
+  };
+  if (!name.compare("CM") || !name.compare("CHCM")) {
+    int32_t depth, width;
+    parser.setWorkingNode("CM.para");
+    if (!parser.parseConfig(depth, "depth"))
+      return nullptr;
+    if (!parser.parseConfig(width, "width"))
+      return nullptr;
+    width = scaled(width);
+    if (!name.compare("CM")) {
+      return std::make_unique<Sketch::CMSketch<key_len, T, hash_t>>(depth,
+                                                                    width);
+    }
+    double cnt_no_ratio;
+    std::vector<size_t> width_cnt, no_hash;
+    parser.setWorkingNode("CM.ch");
+    if (!parser.parseConfig(cnt_no_ratio, "cnt_no_ratio"))
+      return nullptr;
+    if (!parser.parseConfig(width_cnt, "width_cnt"))
+      return nullptr;
+    if (!parser.parseConfig(no_hash, "no_hash"))
+      return nullptr;
+    return std::make_unique<
+        Sketch::CHCMSketch<key_len, ch_layer, T, hash_t>>(
+        depth, width, cnt_no_ratio, width_cnt, no_hash);
+  }
+  if (!name.compare("HP")) {
+    int32_t depth, width;
+    bool fingerprint = false;
+    parser.setWorkingNode("HP.para");
+    if (!parser.parseConfig(depth, "depth"))
+      return nullptr;
+    if (!parser.parseConfig(width, "width"))
+      return nullptr;
+    parser.parseConfig(fingerprint, "fingerprint", false);
+    return std::make_unique<Sketch::HashPipe<key_len, T, hash_t>>(
+        depth, scaled(width), fingerprint);
+  }
+  if (!name.compare("FR")) {
+    int32_t flow_filter_bit, flow_filter_hash, count_table_num,
+        count_table_hash;
+    parser.setWorkingNode("FlowRadar.para");
+    if (!parser.parseConfig(flow_filter_bit, "flow_filter_bit"))
+      return nullptr;
+    if (!parser.parseConfig(flow_filter_hash, "flow_filter_hash"))
+      return nullptr;
+    if (!parser.parseConfig(count_table_num, "count_table_num"))
+      return nullptr;
+    if (!parser.parseConfig(count_table_hash, "count_table_hash"))
+      return nullptr;
+    return std::make_unique<Sketch::FlowRadar<key_len, T, hash_t>>(
+        scaled(flow_filter_bit), flow_filter_hash, scaled(count_table_num),
+        count_table_hash);
+  }
+  LOG(ERROR, fmt::format("Unknown back-end of Cold Filter: {}", name));
+  return nullptr;
+}
+
+template <int32_t key_len, typename T, typename hash_t, int32_t ch_layer>
+void ColdFilterTest<key_len, T, hash_t, ch_layer>::runTest() {
+  /**
+   * @brief shorthand for convenience
+   *
+   */
+  using StreamData = Data::StreamData<key_len>;
+
+  /// Part I.
+  ///   Parse the config file
+  ///
+  int32_t depth_1, width_1, depth_2, width_2, threshold_2; // sketch config
+  std::string backend;
+  double num_heavy_hitter;
+  std::string data_file; // data config
+  toml::array arr;       // shortly we will convert it to format
+
+  Util::ConfigParser parser(config_file);
+  if (!parser.succeed()) {
+    return;
+  }
+  parser.setWorkingNode(CF_PARA_PATH);
+  if (!parser.parseConfig(depth_1, "depth_1"))
+    return;
+  if (!parser.parseConfig(width_1, "width_1"))
+    return;
+  if (!parser.parseConfig(depth_2, "depth_2"))
+    return;
+  if (!parser.parseConfig(width_2, "width_2"))
+    return;
+  if (!parser.parseConfig(threshold_2, "threshold_2"))
+    return;
+  if (!parser.parseConfig(backend, "backend"))
+    return;
+  // whether to test the back-end without the filter, which is optional
+  bool compare = false;
+  parser.parseConfig(compare, "compare", false);
+
+  parser.setWorkingNode(CF_DATA_PATH);
+  if (!parser.parseConfig(num_heavy_hitter, "threshold_heavy_hitter"))
+    return;
+  if (!parser.parseConfig(data_file, "data"))
+    return;
+  if (!parser.parseConfig(arr, "format"))
+    return;
+  Data::DataFormat format(arr);
+  std::string method;
+  Data::HXMethod hx_method = Data::TopK;
+  if (!parser.parseConfig(method, "hx_method"))
+    return;
+  if (!method.compare("Percentile")) {
+    hx_method = Data::Percentile;
+  }
+  Data::CntMethod cnt_method = Data::InLength;
+  if (!parser.parseConfig(method, "cnt_method"))
+    return;
+  if (!method.compare("InPacket")) {
+    cnt_method = Data::InPacket;
+  }
+
+  /// Part II.
+  ///   Prepare sketch and data
+  ///
+  auto ptr_backend = makeBackend(backend);
+  if (!ptr_backend)
+    return;
+  std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr(
+      new Sketch::ColdFilter<key_len, T, hash_t>(depth_1, width_1, depth_2,
+                                                 width_2, threshold_2,
+                                                 std::move(ptr_backend)));
+
+  StreamData data(data_file, format);
+  if (!data.succeed())
+    return;
+  Data::GndTruth<key_len, T> gnd_truth, gnd_truth_heavy_hitters;
+  gnd_truth.getGroundTruth(data.begin(), data.end(), cnt_method);
+  gnd_truth_heavy_hitters.getHeavyHitter(gnd_truth, num_heavy_hitter,
+                                         hx_method);
+  fmt::print("DataSet: {:d} records with {:d} keys ({})\n", data.size(),
+             gnd_truth.size(), data_file);
+
+  /// Part III.
+  ///   Test, with the metrics that apply to the back-end
+  ///
+  const double threshold =
+      hx_method == Data::TopK
+          ? gnd_truth_heavy_hitters.min()
+          // gnd_truth_heavy_hitter: >, yet the sketches: >=
+          : std::floor(gnd_truth.totalValue() * num_heavy_hitter + 1);
+  auto test_all = [&](TestBase<key_len, T> &test,
+                      std::unique_ptr<Sketch::SketchBase<key_len, T>> &ptr) {
+    test.testUpdate(ptr, data.begin(), data.end(), cnt_method);
+    if (backend.compare("FR")) {
+      test.testQuery(ptr, gnd_truth);
+    }
+    if (!backend.compare("HP")) {
+      test.testHeavyHitter(ptr, threshold, gnd_truth_heavy_hitters);
+    }
+    if (!backend.compare("FR")) {
+      test.testDecode(ptr, gnd_truth);
+    }
+    test.testSize(ptr);
+    test.show();
+  };
+  test_all(*this, ptr);
+
+  /// Part IV.
+  ///   [optional] Test the back-end without the filter, scaled to the same
+  ///   memory as the filter and its back-end together
+  ///
+  if (!compare)
+    return;
+  ptr_backend = makeBackend(backend);
+  const double scale = static_cast<double>(ptr->size()) / ptr_backend->size();
+  ptr_backend = makeBackend(backend, scale);
+  TestBase<key_len, T> test(backend, config_file, CF_TEST_PATH);
+  test_all(test, ptr_backend);
+}
+
+} // namespace OmniSketch::Test
+
+#undef CF_PARA_PATH
+#undef CF_TEST_PATH
+#undef CF_DATA_PATH
+
+// Driver instance:
+//      AUTHOR: dromniscience
+//      CONFIG: sketch_config.toml  # with respect to the `src/` directory
+//    TEMPLATE: <13, int32_t, Hash::AwareHash>
@@ -21,10 +21,23 @@ namespace OmniSketch::Test {
  * @brief Testing class for Count Sketch
  *
  */
-template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash>
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash,
+          int32_t Depth = 0, int32_t Width = 0>
 class CountSketchTest : public TestBase<key_len, T> {
   using TestBase<key_len, T>::config_file;
+  /**
+   * @brief The sketch with dimensions `D * W` fixed, or given on construction
+   * if both are 0
+   */
+  template <int32_t D, int32_t W>
+  using Fixed = Sketch::CountSketch<key_len, T, hash_t, D, W>;
 
+  /**
+   * @brief Make a Count Sketch, whose dimensions are fixed in the template if
+   * the config agrees with them, and given on construction otherwise
+   */
+  std::unique_ptr<Sketch::SketchBase<key_len, T>>
+  makeSketch(int32_t depth, int32_t width, int32_t topk) const;
 public:
   /**
    * @brief Constructor
@@ -54,8 +67,21 @@ public:
 
 namespace OmniSketch::Test {
 
-template <int32_t key_len, typename T, typename hash_t>
-void CountSketchTest<key_len, T, hash_t>::runTest() {
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width>
+std::unique_ptr<Sketch::SketchBase<key_len, T>>
+CountSketchTest<key_len, T, hash_t, Depth, Width>::makeSketch(
+    int32_t depth, int32_t width, int32_t topk) const {
+  return makeFixedSketch<Sketch::SketchBase<key_len, T>, Fixed, Depth, Width>(
+      depth, width, [&](auto sketch, int32_t w) {
+        return std::make_unique<typename decltype(sketch)::type>(depth, w,
+                                                                 topk);
+      });
+}
+
+template <int32_t key_len, typename T, typename hash_t, int32_t Depth,
+          int32_t Width>
+void CountSketchTest<key_len, T, hash_t, Depth, Width>::runTest() {
   /**
    * @brief shorthand for convenience
    *
@@ -68,6 +94,7 @@ void CountSketchTest<key_len, T, hash_t>::runTest() {
   /// Step i.  First we list the variables to parse, namely:
   ///
   int32_t depth, width;  // sketch config
+  int32_t topk = 0;      // [optional] top-k tracking
   std::string data_file; // data config
   toml::array arr;       // shortly we will convert it to format
   /// Step ii. Open the config file
@@ -83,6 +110,7 @@ void CountSketchTest<key_len, T, hash_t>::runTest() {
     return;
   if (!parser.parseConfig(width, "width"))
     return;
+  parser.parseConfig(topk, "topk", false);
   /// Step v. Move to the data node
   parser.setWorkingNode(CS_DATA_PATH);
   /// Step vi. Parse data and format
@@ -101,13 +129,19 @@ void CountSketchTest<key_len, T, hash_t>::runTest() {
   if (!method.compare("InPacket")) {
     cnt_method = Data::InPacket;
   }
+  /// Step viii. Parse heavy hitter settings if top-k is tracked
+  double num_heavy_hitter = 0.0;
+  Data::HXMethod hx_method = Data::TopK;
+  if (topk > 0 &&
+      !this->parseHeavyHitter(parser, num_heavy_hitter, hx_method))
+    return;
 
   /// Part II.
   ///   Prepare sketch and data
   ///
   /// Step i. Initialize a sketch
-  std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr(
-      new Sketch::CountSketch<key_len, T, hash_t>(depth, width));
+  std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr =
+      makeSketch(depth, width, topk);
   /// remember that the left ptr must point to the base class in order to call
   /// the methods in it
 
@@ -129,6 +163,10 @@ void CountSketchTest<key_len, T, hash_t>::runTest() {
                    cnt_method); // metrics of interest are in config file
   ///        2. query for all the flowkeys
   this->testQuery(ptr, gnd_truth); // metrics of interest are in config file
+  ///        3. [optional] heavy hitters from the tracked top-k
+  if (topk > 0) {
+    this->testHeavyHitter(ptr, gnd_truth, num_heavy_hitter, hx_method);
+  }
   ///        3. size
   this->testSize(ptr);
   ///        3. show metrics
@@ -146,4 +184,4 @@ void CountSketchTest<key_len, T, hash_t>::runTest() {
 // Driver instance:
 //      AUTHOR: dromniscience
 //      CONFIG: sketch_config.toml  # with respect to the `src/` directory
-//    TEMPLATE: <13, int32_t, Hash::AwareHash>
\ No newline at end of file
+//    TEMPLATE: <13, int32_t, Hash::AwareHash, ${CM.para.depth}, ${NextPrime(CM.para.width)}>
\ No newline at end of file
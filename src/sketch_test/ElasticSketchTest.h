@@ -0,0 +1,207 @@
+/**
+ * @file ElasticSketchTest.h
+ * @author dromniscience (you@domain.com)
+ * @brief Test Elastic Sketch
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <common/test.h>
+#include <sketch/CMSketch.h>
+#include <sketch/ElasticSketch.h>
+#include <sketch_test/HashPipeCompare.h>
+
+#define ES_PARA_PATH "ES.para"
+#define ES_TEST_PATH "ES.test"
+#define ES_DATA_PATH "ES.data"
+#define ES_COMPARE_PATH "ES.compare"
+
+namespace OmniSketch::Test {
+
+/**
+ * @brief Testing class for Elastic Sketch
+ *
+ * @details Optionally, Count Min Sketch and Hash Pipe of the same memory are
+ * tested on the same trace with the same metrics, for comparison. See
+ * compareHashPipe() for the latter.
+ *
+ * @tparam cell_t  type of the cell holding a counter of the light part
+ */
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash,
+          typename cell_t = T>
+class ElasticSketchTest : public TestBase<key_len, T> {
+  using TestBase<key_len, T>::config_file;
+
+public:
+  /**
+   * @brief Constructor
+   * @details Names from left to right are
+   * - show name
+   * - config file
+   * - path to the node that contains metrics of interest (concatenated with
+   * '.')
+   */
+  ElasticSketchTest(const std::string_view config_file)
+      : TestBase<key_len, T>("Elastic", config_file, ES_TEST_PATH) {}
+
+  /**
+   * @brief Test Elastic Sketch
+   * @details An overriden method
+   */
+  void runTest() override;
+};
+
+} // namespace OmniSketch::Test
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Test {
+
+template <int32_t key_len, typename T, typename hash_t, typename cell_t>
+void ElasticSketchTest<key_len, T, hash_t, cell_t>::runTest() {
+  /**
+   * @brief shorthand for convenience
+   *
+   */
+  using StreamData = Data::StreamData<key_len>;
+
+  /// Part I.
+  ///   Parse the config file
+  ///
+  int32_t num_bucket, depth, width; // sketch config
+  int32_t lambda = 8;               // [optional] eviction threshold
+  double num_heavy_hitter, num_heavy_changer;
+  std::string data_file; // data config
+  toml::array arr;       // shortly we will convert it to format
+
+  Util::ConfigParser parser(config_file);
+  if (!parser.succeed()) {
+    return;
+  }
+  parser.setWorkingNode(ES_PARA_PATH);
+  if (!parser.parseConfig(num_bucket, "num_bucket"))
+    return;
+  if (!parser.parseConfig(depth, "depth"))
+    return;
+  if (!parser.parseConfig(width, "width"))
+    return;
+  parser.parseConfig(lambda, "lambda", false);
+  // whether to compare with CM of the same memory, optional
+  bool compare = false;
+  int32_t cm_depth = 5;
+  parser.setWorkingNode(ES_COMPARE_PATH);
+  parser.parseConfig(compare, "compare", false);
+  parser.parseConfig(cm_depth, "cm_depth", false);
+
+  parser.setWorkingNode(ES_DATA_PATH);
+  if (!parser.parseConfig(num_heavy_hitter, "threshold_heavy_hitter"))
+    return;
+  if (!parser.parseConfig(num_heavy_changer, "threshold_heavy_changer"))
+    return;
+  if (!parser.parseConfig(data_file, "data"))
+    return;
+  if (!parser.parseConfig(arr, "format"))
+    return;
+  Data::DataFormat format(arr);
+  std::string method;
+  Data::HXMethod hx_method = Data::TopK;
+  if (!parser.parseConfig(method, "hx_method"))
+    return;
+  if (!method.compare("Percentile")) {
+    hx_method = Data::Percentile;
+  }
+  Data::CntMethod cnt_method = Data::InLength;
+  if (!parser.parseConfig(method, "cnt_method"))
+    return;
+  if (!method.compare("InPacket")) {
+    cnt_method = Data::InPacket;
+  }
+
+  /// Part II.
+  ///   Prepare sketch and data
+  ///
+  using Elastic = Sketch::ElasticSketch<key_len, T, hash_t, cell_t>;
+  std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr(
+      new Elastic(num_bucket, depth, width, lambda));
+
+  StreamData data(data_file, format);
+  if (!data.succeed())
+    return;
+  Data::GndTruth<key_len, T> gnd_truth, gnd_truth_heavy_hitters;
+  gnd_truth.getGroundTruth(data.begin(), data.end(), cnt_method);
+  gnd_truth_heavy_hitters.getHeavyHitter(gnd_truth, num_heavy_hitter,
+                                         hx_method);
+  // heavy changers between the first and the second half of the data
+  const auto mid = data.begin() + data.size() / 2;
+  Data::GndTruth<key_len, T> gnd_truth_heavy_changers;
+  gnd_truth_heavy_changers.getHeavyChanger(data.begin(), mid, mid, data.end(),
+                                           cnt_method, num_heavy_changer,
+                                           hx_method);
+  fmt::print("DataSet: {:d} records with {:d} keys ({})\n", data.size(),
+             gnd_truth.size(), data_file);
+
+  /// Part III.
+  ///   Test
+  ///
+  const double threshold =
+      hx_method == Data::TopK
+          ? gnd_truth_heavy_hitters.min()
+          // gnd_truth_heavy_hitter: >, yet Elastic Sketch: >=
+          : std::floor(gnd_truth.totalValue() * num_heavy_hitter + 1);
+  this->testUpdate(ptr, data.begin(), data.end(), cnt_method);
+  this->testQuery(ptr, gnd_truth);
+  this->testHeavyHitter(ptr, threshold, gnd_truth_heavy_hitters);
+  this->testDecode(ptr, gnd_truth);
+  {
+    std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr_1(
+        new Elastic(num_bucket, depth, width, lambda));
+    std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr_2(
+        new Elastic(num_bucket, depth, width, lambda));
+    for (auto iter = data.begin(); iter != data.end(); ++iter) {
+      (iter < mid ? ptr_1 : ptr_2)
+          ->update(iter->flowkey,
+                   cnt_method == Data::InLength ? iter->length : 1);
+    }
+    // the smallest true change serves as the threshold
+    this->testHeavyChanger(ptr_1, ptr_2, gnd_truth_heavy_changers.min(),
+                           gnd_truth_heavy_changers);
+  }
+  this->testSize(ptr);
+  this->show();
+
+  /// Part IV.
+  ///   [optional] Compare with CM and Hash Pipe of the same memory
+  ///
+  const size_t memory = ptr->size();
+  if (compare) {
+    TestBase<key_len, T> test("Count Min", config_file, ES_TEST_PATH);
+    std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr_cm(
+        new Sketch::CMSketch<key_len, T, hash_t>(
+            cm_depth, memory / cm_depth / sizeof(T)));
+    test.testUpdate(ptr_cm, data.begin(), data.end(), cnt_method);
+    test.testQuery(ptr_cm, gnd_truth);
+    test.testSize(ptr_cm);
+    test.show();
+  }
+  compareHashPipe<key_len, T, hash_t>(
+      config_file, this->test_path, ES_COMPARE_PATH, memory, data.begin(),
+      data.end(), cnt_method, gnd_truth, threshold, gnd_truth_heavy_hitters);
+}
+
+} // namespace OmniSketch::Test
+
+#undef ES_PARA_PATH
+#undef ES_TEST_PATH
+#undef ES_DATA_PATH
+#undef ES_COMPARE_PATH
+
+// Driver instance:
+//      AUTHOR: dromniscience
+//      CONFIG: sketch_config.toml  # with respect to the `src/` directory
+//    TEMPLATE: <13, int32_t, Hash::AwareHash, uint8_t>
@@ -0,0 +1,69 @@
+/**
+ * @file HashPipeCompare.h
+ * @author dromniscience (you@domain.com)
+ * @brief Compare with Hash Pipe of the same memory
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <common/test.h>
+#include <sketch/HashPipe.h>
+
+namespace OmniSketch::Test {
+
+/**
+ * @brief Test Hash Pipe of a given memory on the same data, for comparison
+ * @details Enabled by `hp_compare` under `compare_path`, where `hp_depth` is
+ * the depth of Hash Pipe. The width is chosen so that the slots take `memory`
+ * bytes. Update, query, heavy hitters and size are tested with the metrics
+ * under `test_path` and shown as "Hash Pipe".
+ *
+ * @param config_file   config file of the calling test
+ * @param test_path     path to the node that contains metrics of interest
+ * @param compare_path  path to the node that enables the comparison, usually
+ * in the section of the calling test
+ * @param memory        memory of the slots (in bytes)
+ * @param begin       [begin, end)
+ * @param end         [begin, end)
+ * @param cnt_method  how records are counted
+ * @param gnd_truth   ground truth
+ * @param threshold   threshold value of heavy hitters
+ * @param gnd_truth_heavy_hitters ground truth of heavy hitters
+ */
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash>
+void compareHashPipe(
+    const std::string_view config_file, const std::string_view test_path,
+    const std::string_view compare_path, size_t memory,
+    typename std::vector<Data::Record<key_len>>::const_iterator begin,
+    typename std::vector<Data::Record<key_len>>::const_iterator end,
+    Data::CntMethod cnt_method, const Data::GndTruth<key_len, T> &gnd_truth,
+    double threshold,
+    const Data::GndTruth<key_len, T> &gnd_truth_heavy_hitters) {
+  // config
+  bool compare = false;
+  int32_t depth = 5;
+  Util::ConfigParser parser(config_file);
+  if (!parser.succeed()) {
+    return;
+  }
+  parser.setWorkingNode(compare_path);
+  parser.parseConfig(compare, "hp_compare", false);
+  parser.parseConfig(depth, "hp_depth", false);
+  if (!compare)
+    return;
+
+  const int32_t width = std::max<size_t>(
+      memory / depth / (sizeof(FlowKey<key_len>) + sizeof(T)), 1);
+  TestBase<key_len, T> test("Hash Pipe", config_file, test_path);
+  std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr(
+      new Sketch::HashPipe<key_len, T, hash_t>(depth, width));
+  test.testUpdate(ptr, begin, end, cnt_method);
+  test.testQuery(ptr, gnd_truth);
+  test.testHeavyHitter(ptr, threshold, gnd_truth_heavy_hitters);
+  test.testSize(ptr);
+  test.show();
+}
+
+} // namespace OmniSketch::Test
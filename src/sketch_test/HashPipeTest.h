@@ -85,6 +85,12 @@ void HashPipeTest<key_len, T, hash_t>::runTest() {
     return;
   if (!parser.parseConfig(width, "width"))
     return;
+  // whether to use fingerprinted slots, which is optional
+  bool fingerprint = false;
+  parser.parseConfig(fingerprint, "fingerprint", false);
+  // # threads of the pipelined mode to compare with, which is optional
+  std::vector<int32_t> pipeline_threads;
+  parser.parseConfig(pipeline_threads, "pipeline_threads", false);
   /// Step v. To know about the data, we  switch to [HP.data].
   parser.setWorkingNode(HP_DATA_PATH);
   /// Step vi. Parse data and format
@@ -115,7 +121,7 @@ void HashPipeTest<key_len, T, hash_t>::runTest() {
   ///
   /// Step i. Initialize a sketch
   std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr(
-      new Sketch::HashPipe<key_len, T, hash_t>(depth, width));
+      new Sketch::HashPipe<key_len, T, hash_t>(depth, width, fingerprint));
   /// remember that the left ptr must point to the base class in order to call
   /// the methods in it
 
@@ -138,19 +144,48 @@ void HashPipeTest<key_len, T, hash_t>::runTest() {
   this->testUpdate(ptr, data.begin(), data.end(),
                    cnt_method); // metrics of interest are in config file
   ///        2. query for all the flowkeys
-  if (hx_method == Data::TopK) {
-    this->testHeavyHitter(
-        ptr, gnd_truth_heavy_hitters.min(),
-        gnd_truth_heavy_hitters); // metrics of interest are in config file
-  } else {
-    this->testHeavyHitter(
-        ptr, std::floor(gnd_truth.totalValue() * num_heavy_hitter + 1),
-        gnd_truth_heavy_hitters); // gnd_truth_heavy_hitter: >, yet HashPipe: >=
-  }
+  double threshold =
+      hx_method == Data::TopK
+          ? gnd_truth_heavy_hitters.min()
+          // gnd_truth_heavy_hitter: >, yet HashPipe: >=
+          : std::floor(gnd_truth.totalValue() * num_heavy_hitter + 1);
+  this->testHeavyHitter(
+      ptr, threshold,
+      gnd_truth_heavy_hitters); // metrics of interest are in config file
   ///        3. size
   this->testSize(ptr);
   ///        3. show metrics
   this->show();
+  ///        4. [optional] replay the data in the pipelined mode. 0 thread
+  ///           stands for the serial mode.
+  auto serial = ptr->getHeavyHitter(threshold);
+  for (int32_t threads : pipeline_threads) {
+    Sketch::HashPipe<key_len, T, hash_t> sketch(depth, width, fingerprint);
+    sketch.setPipeline(threads);
+    auto tick = std::chrono::steady_clock::now();
+    for (const auto &record : data) {
+      sketch.update(record.flowkey,
+                    cnt_method == Data::InLength ? record.length : 1);
+    }
+    sketch.sync();
+    double sec = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - tick)
+                     .count();
+    // the pipelined mode should end up with exactly the same slots
+    auto pipelined = sketch.getHeavyHitter(threshold);
+    bool same = (pipelined.size() == serial.size());
+    for (const auto &kv : serial) {
+      same = same && pipelined.count(kv.get_left()) &&
+             pipelined.at(kv.get_left()) == kv.get_right();
+    }
+    fmt::print("Pipeline ({:d} threads): {:.2f} Mpps, {} serial, load:",
+               threads, data.size() / sec / 1e6,
+               same ? "same as" : "DIFFERENT from");
+    for (uint64_t load : sketch.pipelineLoad()) {
+      fmt::print(" {:d}", load);
+    }
+    fmt::print("\n");
+  }
 
   return;
 }
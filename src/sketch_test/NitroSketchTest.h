@@ -0,0 +1,227 @@
+/**
+ * @file NitroSketchTest.h
+ * @author dromniscience (you@domain.com)
+ * @brief Test NitroSketch
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <common/test.h>
+#include <sketch/CMSketch.h>
+#include <sketch/CountSketch.h>
+#include <sketch/NitroSketch.h>
+
+#define NS_PARA_PATH "NS.para"
+#define NS_TEST_PATH "NS.test"
+#define NS_DATA_PATH "NS.data"
+
+namespace OmniSketch::Test {
+
+/**
+ * @brief Testing class for NitroSketch
+ *
+ * @details NitroSketch over Count Min Sketch is tested with the metrics in
+ * config. Then NitroSketch over Count Min Sketch and over Count Sketch are
+ * replayed with each sampling probability in `probs`, which gives the curve
+ * of update rate versus ARE. If `budget` is positive, the adaptive mode is
+ * replayed as well.
+ */
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash>
+class NitroSketchTest : public TestBase<key_len, T> {
+  using TestBase<key_len, T>::config_file;
+
+  /**
+   * @brief Replay the data into a fresh NitroSketch over `sketch_t`, and
+   * query every flow
+   * @details Timestamps are passed to the sketch iff `budget` is positive.
+   * @return update rate in Mpps, ARE, and the final sampling probability
+   */
+  template <typename sketch_t>
+  std::tuple<double, double, double>
+  replay(int32_t depth, int32_t width, double prob, double budget,
+         const Data::StreamData<key_len> &data, Data::CntMethod cnt_method,
+         const Data::GndTruth<key_len, T> &gnd_truth);
+
+public:
+  /**
+   * @brief Constructor
+   * @details Names from left to right are
+   * - show name
+   * - config file
+   * - path to the node that contains metrics of interest (concatenated with
+   * '.')
+   */
+  NitroSketchTest(const std::string_view config_file)
+      : TestBase<key_len, T>("Nitro", config_file, NS_TEST_PATH) {}
+
+  /**
+   * @brief Test NitroSketch
+   * @details An overriden method
+   */
+  void runTest() override;
+};
+
+} // namespace OmniSketch::Test
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Test {
+
+template <int32_t key_len, typename T, typename hash_t>
+template <typename sketch_t>
+std::tuple<double, double, double>
+NitroSketchTest<key_len, T, hash_t>::replay(
+    int32_t depth, int32_t width, double prob, double budget,
+    const Data::StreamData<key_len> &data, Data::CntMethod cnt_method,
+    const Data::GndTruth<key_len, T> &gnd_truth) {
+  std::unique_ptr<Sketch::NitroSketch<key_len, T, sketch_t>> sketch(
+      new Sketch::NitroSketch<key_len, T, sketch_t>(depth, width, prob,
+                                                    budget));
+  auto tick = std::chrono::steady_clock::now();
+  if (budget > 0) {
+    for (const auto &record : data) {
+      sketch->advance(record.timestamp);
+      sketch->update(record.flowkey,
+                     cnt_method == Data::InLength ? record.length : 1);
+    }
+  } else {
+    for (const auto &record : data) {
+      sketch->update(record.flowkey,
+                     cnt_method == Data::InLength ? record.length : 1);
+    }
+  }
+  double sec =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - tick)
+          .count();
+
+  std::vector<FlowKey<key_len>> flowkeys;
+  flowkeys.reserve(gnd_truth.size());
+  for (const auto &kv : gnd_truth) {
+    flowkeys.push_back(kv.get_left());
+  }
+  std::vector<T> estimated;
+  sketch->queryMany(flowkeys.data(), flowkeys.size(), estimated);
+  double ARE = 0.0;
+  size_t i = 0;
+  for (const auto &kv : gnd_truth) {
+    ARE += std::abs(static_cast<double>(kv.get_right()) - estimated[i++]) /
+           kv.get_right();
+  }
+  return {data.size() / sec / 1e6, flowkeys.empty() ? 0.0 : ARE / i,
+          sketch->getProb()};
+}
+
+template <int32_t key_len, typename T, typename hash_t>
+void NitroSketchTest<key_len, T, hash_t>::runTest() {
+  /**
+   * @brief shorthand for convenience
+   *
+   */
+  using StreamData = Data::StreamData<key_len>;
+  using CM = Sketch::CMSketch<key_len, T, hash_t>;
+  using CS = Sketch::CountSketch<key_len, T, hash_t>;
+
+  /// Part I.
+  ///   Parse the config file
+  ///
+  int32_t depth, width;       // sketch config
+  double prob;                // sampling probability
+  std::vector<double> probs;  // [optional] probabilities to sweep
+  double budget = 0.0;        // [optional] adaptive mode
+  std::string data_file;      // data config
+  toml::array arr;            // shortly we will convert it to format
+
+  Util::ConfigParser parser(config_file);
+  if (!parser.succeed()) {
+    return;
+  }
+  parser.setWorkingNode(NS_PARA_PATH);
+  if (!parser.parseConfig(depth, "depth"))
+    return;
+  if (!parser.parseConfig(width, "width"))
+    return;
+  if (!parser.parseConfig(prob, "prob"))
+    return;
+  parser.parseConfig(probs, "probs", false);
+  parser.parseConfig(budget, "budget", false);
+
+  parser.setWorkingNode(NS_DATA_PATH);
+  if (!parser.parseConfig(data_file, "data"))
+    return;
+  if (!parser.parseConfig(arr, "format"))
+    return;
+  Data::DataFormat format(arr);
+  std::string method;
+  Data::CntMethod cnt_method = Data::InLength;
+  if (!parser.parseConfig(method, "cnt_method"))
+    return;
+  if (!method.compare("InPacket")) {
+    cnt_method = Data::InPacket;
+  }
+
+  /// Part II.
+  ///   Prepare sketch and data
+  ///
+  std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr(
+      new Sketch::NitroSketch<key_len, T, CM>(depth, width, prob));
+
+  StreamData data(data_file, format);
+  if (!data.succeed())
+    return;
+  Data::GndTruth<key_len, T> gnd_truth;
+  gnd_truth.getGroundTruth(data.begin(), data.end(), cnt_method);
+  fmt::print("DataSet: {:d} records with {:d} keys ({})\n", data.size(),
+             gnd_truth.size(), data_file);
+
+  /// Part III.
+  ///   Test
+  ///
+  this->testUpdate(ptr, data.begin(), data.end(), cnt_method);
+  this->testQuery(ptr, gnd_truth);
+  this->testSize(ptr);
+  this->show();
+
+  /// Part IV.
+  ///   [optional] Update rate versus ARE
+  ///
+  if (!probs.empty()) {
+    fmt::print("Sampling over {:d} * {:d} counters:\n", depth, width);
+    fmt::print("  {:>8}  {:>18}  {:>18}\n", "prob", "Count Min", "Count");
+    for (double p : probs) {
+      auto [cm_rate, cm_ARE, cm_prob] =
+          replay<CM>(depth, width, p, 0.0, data, cnt_method, gnd_truth);
+      auto [cs_rate, cs_ARE, cs_prob] =
+          replay<CS>(depth, width, p, 0.0, data, cnt_method, gnd_truth);
+      fmt::print("  {:>8g}  {:>7.2f} Mpps {:>8.4g}  {:>7.2f} Mpps {:>8.4g}\n",
+                 p, cm_rate, cm_ARE, cs_rate, cs_ARE);
+    }
+  }
+  if (budget > 0) {
+    auto [cm_rate, cm_ARE, cm_prob] =
+        replay<CM>(depth, width, prob, budget, data, cnt_method, gnd_truth);
+    auto [cs_rate, cs_ARE, cs_prob] =
+        replay<CS>(depth, width, prob, budget, data, cnt_method, gnd_truth);
+    fmt::print("Adaptive sampling with {:g} M row updates/s:\n", budget);
+    fmt::print("  Count Min: {:.2f} Mpps, ARE {:.4g}, final prob {:g}\n",
+               cm_rate, cm_ARE, cm_prob);
+    fmt::print("  Count    : {:.2f} Mpps, ARE {:.4g}, final prob {:g}\n",
+               cs_rate, cs_ARE, cs_prob);
+  }
+}
+
+} // namespace OmniSketch::Test
+
+#undef NS_PARA_PATH
+#undef NS_TEST_PATH
+#undef NS_DATA_PATH
+
+// Driver instance:
+//      AUTHOR: dromniscience
+//      CONFIG: sketch_config.toml  # with respect to the `src/` directory
+//    TEMPLATE: <13, int32_t, Hash::AwareHash>
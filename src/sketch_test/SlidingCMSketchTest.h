@@ -0,0 +1,129 @@
+/**
+ * @file SlidingCMSketchTest.h
+ * @author dromniscience (you@domain.com)
+ * @brief Test Sliding-Window Count Min Sketch
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <common/test.h>
+#include <sketch/SlidingCMSketch.h>
+
+#define SCM_PARA_PATH "SCM.para"
+#define SCM_TEST_PATH "SCM.test"
+#define SCM_DATA_PATH "SCM.data"
+
+namespace OmniSketch::Test {
+
+/**
+ * @brief Testing class for Sliding-Window Count Min Sketch
+ *
+ * @details Records are replayed in the order of their timestamps. Each time a
+ * segment ends, all flows in the current window are queried and compared
+ * with the ground truth of the same window. See
+ * TestBase::testSlidingWindow().
+ */
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash>
+class SlidingCMSketchTest : public TestBase<key_len, T> {
+  using TestBase<key_len, T>::config_file;
+
+public:
+  /**
+   * @brief Constructor
+   * @details Names from left to right are
+   * - show name
+   * - config file
+   * - path to the node that contains metrics of interest (concatenated with
+   * '.')
+   */
+  SlidingCMSketchTest(const std::string_view config_file)
+      : TestBase<key_len, T>("Sliding Count Min", config_file, SCM_TEST_PATH) {
+  }
+
+  /**
+   * @brief Test Sliding-Window Count Min Sketch
+   * @details An overriden method
+   */
+  void runTest() override;
+};
+
+} // namespace OmniSketch::Test
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Test {
+
+template <int32_t key_len, typename T, typename hash_t>
+void SlidingCMSketchTest<key_len, T, hash_t>::runTest() {
+  /**
+   * @brief shorthand for convenience
+   *
+   */
+  using StreamData = Data::StreamData<key_len>;
+
+  int32_t depth, width, num_seg; // sketch config
+  size_t window;                 // in microseconds
+  std::string data_file;         // data config
+  toml::array arr;               // shortly we will convert it to format
+
+  Util::ConfigParser parser(config_file);
+  if (!parser.succeed()) {
+    return;
+  }
+  parser.setWorkingNode(SCM_PARA_PATH);
+  if (!parser.parseConfig(depth, "depth"))
+    return;
+  if (!parser.parseConfig(width, "width"))
+    return;
+  if (!parser.parseConfig(window, "window"))
+    return;
+  if (!parser.parseConfig(num_seg, "num_segment"))
+    return;
+
+  parser.setWorkingNode(SCM_DATA_PATH);
+  if (!parser.parseConfig(data_file, "data"))
+    return;
+  if (!parser.parseConfig(arr, "format"))
+    return;
+  Data::DataFormat format(arr);
+  std::string method;
+  Data::CntMethod cnt_method = Data::InLength;
+  if (!parser.parseConfig(method, "cnt_method"))
+    return;
+  if (!method.compare("InPacket")) {
+    cnt_method = Data::InPacket;
+  }
+
+  auto sketch = new Sketch::SlidingCMSketch<key_len, T, hash_t>(
+      depth, width, window, num_seg);
+  std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr(sketch);
+
+  StreamData data(data_file, format);
+  if (!data.succeed())
+    return;
+  fmt::print("DataSet: {:d} records ({}), window {:g} s in {:d} segments\n",
+             data.size(), data_file, window / 1e6, num_seg);
+
+  this->testSlidingWindow(
+      ptr, [sketch](int64_t timestamp) { sketch->advance(timestamp); },
+      data.begin(), data.end(), cnt_method, window, window / num_seg);
+  this->testSize(ptr);
+  this->show();
+}
+
+} // namespace OmniSketch::Test
+
+#undef SCM_PARA_PATH
+#undef SCM_TEST_PATH
+#undef SCM_DATA_PATH
+
+// Driver instance:
+//      AUTHOR: dromniscience
+//      CONFIG: sketch_config.toml  # with respect to the `src/` directory
+//    TEMPLATE: <13, int32_t, Hash::AwareHash>
@@ -0,0 +1,156 @@
+/**
+ * @file SpaceSavingTest.h
+ * @author dromniscience (you@domain.com)
+ * @brief Test Space Saving
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <common/test.h>
+#include <sketch/SpaceSaving.h>
+#include <sketch_test/HashPipeCompare.h>
+
+#define SS_PARA_PATH "SS.para"
+#define SS_TEST_PATH "SS.test"
+#define SS_DATA_PATH "SS.data"
+#define SS_COMPARE_PATH "SS.compare"
+
+namespace OmniSketch::Test {
+
+/**
+ * @brief Testing class for Space Saving
+ *
+ * @details Optionally, Hash Pipe of the same memory is tested on the same
+ * trace with the same metrics, for comparison. See
+ * compareHashPipe().
+ */
+template <int32_t key_len, typename T, typename hash_t = Hash::AwareHash>
+class SpaceSavingTest : public TestBase<key_len, T> {
+  using TestBase<key_len, T>::config_file;
+
+public:
+  /**
+   * @brief Constructor
+   * @details Names from left to right are
+   * - show name
+   * - config file
+   * - path to the node that contains metrics of interest (concatenated with
+   * '.')
+   */
+  SpaceSavingTest(const std::string_view config_file)
+      : TestBase<key_len, T>("Space Saving", config_file, SS_TEST_PATH) {}
+
+  /**
+   * @brief Test Space Saving
+   * @details An overriden method
+   */
+  void runTest() override;
+};
+
+} // namespace OmniSketch::Test
+
+//-----------------------------------------------------------------------------
+//
+///                        Implementation of templated methods
+//
+//-----------------------------------------------------------------------------
+
+namespace OmniSketch::Test {
+
+template <int32_t key_len, typename T, typename hash_t>
+void SpaceSavingTest<key_len, T, hash_t>::runTest() {
+  /**
+   * @brief shorthand for convenience
+   *
+   */
+  using StreamData = Data::StreamData<key_len>;
+
+  /// Part I.
+  ///   Parse the config file
+  ///
+  int32_t capacity;      // sketch config
+  double num_heavy_hitter;
+  std::string data_file; // data config
+  toml::array arr;       // shortly we will convert it to format
+
+  Util::ConfigParser parser(config_file);
+  if (!parser.succeed()) {
+    return;
+  }
+  parser.setWorkingNode(SS_PARA_PATH);
+  if (!parser.parseConfig(capacity, "capacity"))
+    return;
+
+  parser.setWorkingNode(SS_DATA_PATH);
+  if (!parser.parseConfig(num_heavy_hitter, "threshold_heavy_hitter"))
+    return;
+  if (!parser.parseConfig(data_file, "data"))
+    return;
+  if (!parser.parseConfig(arr, "format"))
+    return;
+  Data::DataFormat format(arr);
+  std::string method;
+  Data::HXMethod hx_method = Data::TopK;
+  if (!parser.parseConfig(method, "hx_method"))
+    return;
+  if (!method.compare("Percentile")) {
+    hx_method = Data::Percentile;
+  }
+  Data::CntMethod cnt_method = Data::InLength;
+  if (!parser.parseConfig(method, "cnt_method"))
+    return;
+  if (!method.compare("InPacket")) {
+    cnt_method = Data::InPacket;
+  }
+
+  /// Part II.
+  ///   Prepare sketch and data
+  ///
+  std::unique_ptr<Sketch::SketchBase<key_len, T>> ptr(
+      new Sketch::SpaceSaving<key_len, T, hash_t>(capacity));
+
+  StreamData data(data_file, format);
+  if (!data.succeed())
+    return;
+  Data::GndTruth<key_len, T> gnd_truth, gnd_truth_heavy_hitters;
+  gnd_truth.getGroundTruth(data.begin(), data.end(), cnt_method);
+  gnd_truth_heavy_hitters.getHeavyHitter(gnd_truth, num_heavy_hitter,
+                                         hx_method);
+  fmt::print("DataSet: {:d} records with {:d} keys ({})\n", data.size(),
+             gnd_truth.size(), data_file);
+
+  /// Part III.
+  ///   Test
+  ///
+  const double threshold =
+      hx_method == Data::TopK
+          ? gnd_truth_heavy_hitters.min()
+          // gnd_truth_heavy_hitter: >, yet Space Saving: >=
+          : std::floor(gnd_truth.totalValue() * num_heavy_hitter + 1);
+  this->testUpdate(ptr, data.begin(), data.end(), cnt_method);
+  this->testQuery(ptr, gnd_truth);
+  this->testHeavyHitter(ptr, threshold, gnd_truth_heavy_hitters);
+  this->testSize(ptr);
+  this->show();
+
+  /// Part IV.
+  ///   [optional] Compare with Hash Pipe of the same memory
+  ///
+  compareHashPipe<key_len, T, hash_t>(
+      config_file, this->test_path, SS_COMPARE_PATH, ptr->size(), data.begin(),
+      data.end(), cnt_method, gnd_truth, threshold, gnd_truth_heavy_hitters);
+}
+
+} // namespace OmniSketch::Test
+
+#undef SS_PARA_PATH
+#undef SS_TEST_PATH
+#undef SS_DATA_PATH
+#undef SS_COMPARE_PATH
+
+// Driver instance:
+//      AUTHOR: dromniscience
+//      CONFIG: sketch_config.toml  # with respect to the `src/` directory
+//    TEMPLATE: <13, int32_t, Hash::AwareHash>
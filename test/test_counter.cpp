@@ -0,0 +1,92 @@
+/**
+ * @file test_counter.cpp
+ * @author dromniscience (you@domain.com)
+ * @brief Test table of narrow saturating counters
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "test_factory.h"
+#include <common/counter.h>
+#include <random>
+#include <vector>
+
+/**
+ * @cond TEST
+ *
+ */
+void TestCounterTable() {
+  using namespace OmniSketch;
+
+  try {
+    Util::CounterTable<int32_t, uint8_t, 2, 0> table(3, 10);
+    SET_FAILURE_FLAG;
+  } catch (const std::invalid_argument &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
+
+  // narrow cells agree with wide counters, escalating only large ones
+  try {
+    constexpr int32_t rows = 3, cols = 1000;
+    Util::CounterTable<int64_t, uint8_t> table(rows, cols);
+    std::vector<int64_t> truth(rows * cols, 0);
+    std::mt19937 gen(42);
+    VERIFY(table.numCell() == rows * cols);
+    for (int32_t i = 0; i < 100000; ++i) {
+      size_t pos = table.offset(gen() % rows, gen() % cols);
+      int64_t val = (i % 1000 == 0) ? 100000 : gen() % 3;
+      VERIFY(table.add(pos, val) == (truth[pos] += val));
+    }
+    for (int32_t i = 0; i < 1000; ++i) {
+      size_t pos = gen() % truth.size();
+      table.raise(pos, 260);
+      truth[pos] = std::max<int64_t>(truth[pos], 260);
+      table.set(gen() % truth.size(), 0); // escalated cells stay escalated
+    }
+    size_t escalated = 0;
+    bool match = true;
+    for (size_t pos = 0; pos < truth.size(); ++pos) {
+      truth[pos] = table.get(pos); // the set() above is not tracked
+      escalated += (table.data()[pos] == 255);
+    }
+    for (size_t pos = 0; pos < truth.size(); ++pos) {
+      table.add(pos, 1);
+      match = match && table.get(pos) == truth[pos] + 1;
+    }
+    VERIFY(match);
+    VERIFY(escalated == table.numEscalated());
+    VERIFY(escalated > 0 && escalated < truth.size());
+    VERIFY(table.size() >= sizeof(uint8_t) * truth.size() +
+                               escalated * (sizeof(size_t) + sizeof(int64_t)));
+
+    table.clear();
+    VERIFY(table.numEscalated() == 0);
+    match = true;
+    for (size_t pos = 0; pos < truth.size(); ++pos) {
+      match = match && table.get(pos) == 0;
+    }
+    VERIFY(match);
+    VERIFY(table.add(5, 254) == 254 && table.numEscalated() == 0);
+    VERIFY(table.add(5, 1) == 255 && table.numEscalated() == 1);
+  } catch (const std::exception &exp) {
+    VERIFY_NO_EXCEPTION(exp);
+  }
+
+  // plain cells
+  try {
+    Util::CounterTable<int32_t, int32_t, 2, 16> table(2, 16);
+    VERIFY(table.size() == 0);
+    VERIFY(table.add(table.offset(1, 3), 1 << 20) == 1 << 20);
+    table.raise(table.offset(1, 3), 5);
+    VERIFY(table.get(19) == 1 << 20 && table.numEscalated() == 0);
+  } catch (const std::exception &exp) {
+    VERIFY_NO_EXCEPTION(exp);
+  }
+}
+
+OMNISKETCH_DECLARE_TEST(counter) {
+  for (int i = 0; i < g_repeat; ++i) {
+    TestCounterTable();
+  }
+}
+/** @endcond */
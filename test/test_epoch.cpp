@@ -0,0 +1,107 @@
+/**
+ * @file test_epoch.cpp
+ * @author dromniscience (you@domain.com)
+ * @brief Test epoch rotator
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "test_factory.h"
+#include <common/epoch.h>
+#include <common/sketch.h>
+#include <sketch/CMSketch.h>
+#include <vector>
+
+/**
+ * @cond TEST
+ *
+ */
+namespace {
+/**
+ * @brief A sketch that records what it has seen
+ *
+ */
+class Recorder {
+public:
+  std::vector<int32_t> seen;
+  Recorder(int32_t reserve) { seen.reserve(reserve); }
+  void clear() { seen.clear(); }
+};
+} // namespace
+
+void TestEpochRotator() {
+  using namespace OmniSketch;
+
+  // each epoch starts empty and the last one keeps its records
+  try {
+    Util::EpochRotator<Recorder> rotator(100);
+    VERIFY(rotator.epoch() == 0 && rotator.last().seen.empty());
+    bool match = true;
+    for (int32_t epoch = 0; epoch < 50; ++epoch) {
+      match = match && rotator.current().seen.empty();
+      for (int32_t i = 0; i < epoch; ++i) {
+        rotator.current().seen.push_back(epoch);
+      }
+      Recorder &next = rotator.rotate();
+      match = match && (&next == &rotator.current());
+      match = match && rotator.last().seen.size() == epoch;
+      for (int32_t val : rotator.last().seen) {
+        match = match && val == epoch;
+      }
+    }
+    rotator.sync();
+    VERIFY(match);
+    VERIFY(rotator.epoch() == 50);
+  } catch (const std::exception &exp) {
+    VERIFY_NO_EXCEPTION(exp);
+  }
+
+  // with a real sketch
+  try {
+    Util::EpochRotator<Sketch::CMSketch<4, int32_t>> rotator(3, 1000);
+    bool match = true;
+    for (int32_t epoch = 1; epoch <= 5; ++epoch) {
+      for (int32_t key = 0; key < 100; ++key) {
+        rotator.current().update(FlowKey<4>(key), epoch);
+      }
+      rotator.rotate();
+      for (int32_t key = 0; key < 100; ++key) {
+        match = match && rotator.last().query(FlowKey<4>(key)) >= epoch;
+        match = match && rotator.current().query(FlowKey<4>(key)) == 0;
+      }
+    }
+    VERIFY(match);
+  } catch (const std::exception &exp) {
+    VERIFY_NO_EXCEPTION(exp);
+  }
+
+  // with instances taken over through the base class
+  try {
+    using Base = Sketch::SketchBase<4, int32_t>;
+    Util::EpochRotator<Base> rotator(
+        std::unique_ptr<Base>(new Sketch::CMSketch<4, int32_t>(3, 1000)),
+        std::unique_ptr<Base>(new Sketch::CMSketch<4, int32_t>(3, 1000)),
+        std::unique_ptr<Base>(new Sketch::CMSketch<4, int32_t>(3, 1000)));
+    bool match = true;
+    for (int32_t epoch = 1; epoch <= 5; ++epoch) {
+      for (int32_t key = 0; key < 100; ++key) {
+        rotator.current().update(FlowKey<4>(key), epoch);
+      }
+      rotator.rotate();
+      for (int32_t key = 0; key < 100; ++key) {
+        match = match && rotator.last().query(FlowKey<4>(key)) >= epoch;
+        match = match && rotator.current().query(FlowKey<4>(key)) == 0;
+      }
+    }
+    VERIFY(match);
+  } catch (const std::exception &exp) {
+    VERIFY_NO_EXCEPTION(exp);
+  }
+}
+
+OMNISKETCH_DECLARE_TEST(epoch) {
+  for (int i = 0; i < g_repeat; ++i) {
+    TestEpochRotator();
+  }
+}
+/** @endcond */
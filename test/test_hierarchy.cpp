@@ -8,6 +8,7 @@
  */
 #include "test_factory.h"
 #include <common/hierarchy.h>
+#include <map>
 
 /**
  * @cond TEST
@@ -162,13 +163,132 @@ void TestDynamicIntX() {
   }
 }
 
+void TestPackedIntArray() {
+  using namespace OmniSketch::Util;
+
+  // invalid length
+  try {
+    PackedIntArray<int64_t> a(10, 0);
+    SET_FAILURE_FLAG;
+  } catch (const std::length_error &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
+  try {
+    PackedIntArray<int64_t> a(10, 64);
+    SET_FAILURE_FLAG;
+  } catch (const std::length_error &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
+  try {
+    PackedIntArray<int32_t> a(10, 32);
+    SET_FAILURE_FLAG;
+  } catch (const std::length_error &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
+
+  // same carry-outs as DynamicIntX, neighbours untouched
+  try {
+    for (size_t bits = 1; bits < 62; ++bits) {
+      constexpr size_t n = 67;
+      PackedIntArray<int64_t> a(n, bits);
+      std::vector<DynamicIntX<int64_t>> b(n, {bits});
+      uint64_t x = 0x9e3779b97f4a7c15ULL + bits;
+      for (size_t k = 0; k < 8 * n; ++k) {
+        x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+        size_t i = x % n;
+        int64_t val = static_cast<int64_t>(x >> (x % 64)) % (1LL << 40);
+        if (x & 1)
+          val = -val;
+        VERIFY(a.add(i, val) == b[i] + val);
+      }
+      for (size_t i = 0; i < n; ++i) {
+        VERIFY(a.getVal(i) == b[i].getVal());
+      }
+    }
+  } catch (const std::overflow_error &exp) {
+    VERIFY_NO_EXCEPTION(exp);
+  }
+
+  // widest counters
+  try {
+    PackedIntArray<int64_t> a(5, 63);
+    constexpr int64_t max = std::numeric_limits<int64_t>::max();
+    VERIFY(a.add(1, max >> 1) == 0);
+    VERIFY(a.add(1, max >> 1) == 0);
+    VERIFY(a.add(1, 1) == 0);
+    VERIFY(a.getVal(1) == max);
+    VERIFY(a.add(1, 1) == 1);
+    VERIFY(a.getVal(1) == 0);
+    VERIFY(a.add(1, -1) == -1);
+    VERIFY(a.getVal(1) == max);
+    VERIFY(a.getVal(0) == 0 && a.getVal(2) == 0);
+    a.clear();
+    VERIFY(a.getVal(1) == 0);
+  } catch (const std::overflow_error &exp) {
+    VERIFY_NO_EXCEPTION(exp);
+  }
+}
+
+void TestPendingBuffer() {
+  using namespace OmniSketch::Util;
+
+  // invalid capacity
+  try {
+    PendingBuffer<int32_t> a(0);
+    SET_FAILURE_FLAG;
+  } catch (const std::invalid_argument &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
+
+  // sums up by index, in order of arrival, across clears
+  try {
+    constexpr size_t n = 100;
+    PendingBuffer<int32_t> a(n);
+    for (size_t round = 0; round < 3; ++round) {
+      std::map<size_t, int32_t> b;
+      std::vector<size_t> order;
+      uint64_t x = 0x9e3779b97f4a7c15ULL + round;
+      for (size_t k = 0; k < 8 * n; ++k) {
+        x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+        size_t i = (x % n) * 7919 + round;
+        int32_t val = 1 + x % 7;
+        if (!b.count(i))
+          order.push_back(i);
+        b[i] += val;
+        a.add(i, val);
+      }
+      VERIFY(a.size() == order.size());
+      for (size_t k = 0; k < order.size(); ++k) {
+        VERIFY(a.key(k) == order[k]);
+        VERIFY(a.val(k) == b[order[k]]);
+      }
+      a.clear();
+      VERIFY(a.empty());
+    }
+  } catch (const std::exception &exp) {
+    VERIFY_NO_EXCEPTION(exp);
+  }
+
+  // full
+  try {
+    PendingBuffer<int32_t> a(2);
+    a.add(1, 1);
+    a.add(2, 1);
+    a.add(3, 1);
+    SET_FAILURE_FLAG;
+  } catch (const std::length_error &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
+}
+
 void TestHierarchy() {
   using namespace OmniSketch::Sketch;
 
   const std::vector<size_t> no_cnt = {7, 5, 3};
   const std::vector<size_t> width_cnt = {10, 10, 10};
   const std::vector<size_t> no_hash = {2, 2};
-  CounterHierarchy<3, int32_t, TestHash> ch(no_cnt, width_cnt, no_hash);
+  CounterHierarchy<3, int32_t, TestHash> ch(no_cnt, width_cnt, no_hash, 4096,
+                                            true);
 
   // normal case
   try {
@@ -247,6 +367,38 @@ void TestHierarchy() {
     VERIFY_NO_EXCEPTION(exp);
   }
 
+  // bounded lazy-update buffer, flushed by updates
+  try {
+    CounterHierarchy<3, int32_t, TestHash> small(no_cnt, width_cnt, no_hash,
+                                                 3, true);
+    constexpr int32_t a[7] = {3309568, 356352001, 163842, 10243, 1028, 5, 6};
+    for (size_t i = 0; i < 7; ++i) {
+      small.updateCnt(i, a[i] % 10);
+    }
+    for (size_t j = 0; j < 10; ++j) {
+      for (size_t i = 0; i < 7; ++i) {
+        small.updateCnt(i, a[i] / 10);
+      }
+    }
+    for (size_t i = 0; i < 7; ++i) {
+      VERIFY(small.getCnt(i) == a[i]);
+      VERIFY(small.getOriginalCnt(i) == a[i]);
+    }
+  } catch (const std::exception &exp) {
+    VERIFY_NO_EXCEPTION(exp);
+  }
+
+  // original counters are not kept by default
+  try {
+    CounterHierarchy<3, int32_t, TestHash> plain(no_cnt, width_cnt, no_hash);
+    plain.updateCnt(0, 1);
+    VERIFY(plain.getCnt(0) == 1);
+    plain.getOriginalCnt(0);
+    SET_FAILURE_FLAG;
+  } catch (const std::runtime_error &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
+
   // exception
   try {
     ch.clear();
@@ -322,11 +474,20 @@ void TestHierarchy() {
   } catch (const std::exception &exp) {
     VERIFY_EXCEPTION(exp);
   }
+  try {
+    CounterHierarchy<3, int32_t, TestHash> ch({100, 50, 10}, {20, 5, 5},
+                                              {2, 3}, 0);
+    SET_FAILURE_FLAG;
+  } catch (const std::exception &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
 }
 
 OMNISKETCH_DECLARE_TEST(hierarchy) {
   for (int i = 0; i < g_repeat; ++i) {
     TestDynamicIntX();
+    TestPackedIntArray();
+    TestPendingBuffer();
     TestHierarchy();
   }
 }
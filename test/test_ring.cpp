@@ -0,0 +1,81 @@
+/**
+ * @file test_ring.cpp
+ * @author dromniscience (you@domain.com)
+ * @brief Test SPSC ring
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "test_factory.h"
+#include <common/ring.h>
+#include <thread>
+
+/**
+ * @cond TEST
+ *
+ */
+void TestSPSCRing() {
+  using namespace OmniSketch;
+
+  try {
+    Util::SPSCRing<int32_t> ring(0);
+    SET_FAILURE_FLAG;
+  } catch (const std::invalid_argument &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
+
+  // single thread: capacity, FIFO order, full and empty
+  try {
+    Util::SPSCRing<int32_t> ring(5);
+    VERIFY(ring.size() == 8);
+    int32_t val = -1;
+    VERIFY(!ring.tryPop(val) && val == -1);
+    for (int32_t round = 0; round < 3; ++round) {
+      for (int32_t i = 0; i < 8; ++i) {
+        VERIFY(ring.tryPush(round * 8 + i));
+      }
+      VERIFY(!ring.tryPush(-1));
+      for (int32_t i = 0; i < 8; ++i) {
+        VERIFY(ring.tryPop(val) && val == round * 8 + i);
+      }
+      VERIFY(!ring.tryPop(val));
+    }
+  } catch (const std::exception &exp) {
+    VERIFY_NO_EXCEPTION(exp);
+  }
+
+  // two threads: nothing lost, duplicated or reordered
+  try {
+    constexpr int32_t num = 200000;
+    Util::SPSCRing<int32_t> ring(64);
+    std::thread producer([&ring] {
+      for (int32_t i = 0; i < num; ++i) {
+        while (!ring.tryPush(i)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+    int32_t expected = 0, val;
+    bool in_order = true;
+    while (expected < num) {
+      if (!ring.tryPop(val)) {
+        std::this_thread::yield();
+        continue;
+      }
+      in_order = in_order && (val == expected);
+      expected++;
+    }
+    producer.join();
+    VERIFY(in_order);
+    VERIFY(!ring.tryPop(val));
+  } catch (const std::exception &exp) {
+    VERIFY_NO_EXCEPTION(exp);
+  }
+}
+
+OMNISKETCH_DECLARE_TEST(ring) {
+  for (int i = 0; i < g_repeat; ++i) {
+    TestSPSCRing();
+  }
+}
+/** @endcond */
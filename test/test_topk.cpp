@@ -0,0 +1,88 @@
+/**
+ * @file test_topk.cpp
+ * @author dromniscience (you@domain.com)
+ * @brief Test top-k heap
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "test_factory.h"
+#include <algorithm>
+#include <common/topk.h>
+#include <map>
+
+/**
+ * @cond TEST
+ *
+ */
+void TestTopKHeap() {
+  using namespace OmniSketch;
+
+  try {
+    Sketch::TopKHeap<4, int32_t> heap(0);
+    SET_FAILURE_FLAG;
+  } catch (const std::invalid_argument &exp) {
+    VERIFY_EXCEPTION(exp);
+  }
+
+  // feed increasing values as a sketch would
+  try {
+    constexpr int32_t k = 10;
+    Sketch::TopKHeap<4, int32_t> heap(k);
+    std::map<int32_t, int32_t> truth;
+    VERIFY(heap.empty());
+    for (int32_t i = 0; i < 97 * 50; ++i) {
+      int32_t key = (i * 7919) % 97;
+      int32_t val = (truth[key] += key);
+      if (heap.admits(val))
+        heap.update(FlowKey<4>(key), val);
+    }
+    VERIFY(heap.end() - heap.begin() == k);
+    // the largest values are held by the largest keys
+    std::map<int32_t, int32_t> held;
+    for (const auto &kv : heap) {
+      held[kv.first.getIp()] = kv.second;
+    }
+    VERIFY(held.size() == k);
+    for (const auto &kv : held) {
+      VERIFY(kv.first >= 97 - k);
+      VERIFY(kv.second == truth[kv.first]);
+    }
+    VERIFY(heap.min() == truth[97 - k]);
+    VERIFY(!heap.admits(heap.min()));
+    VERIFY(heap.admits(heap.min() + 1));
+
+    // decrease a value so that it becomes the minimum
+    heap.update(FlowKey<4>(96), 1);
+    VERIFY(heap.min() == 1);
+    heap.update(FlowKey<4>(1000), 2);
+    held.clear();
+    for (const auto &kv : heap) {
+      held[kv.first.getIp()] = kv.second;
+    }
+    VERIFY(!held.count(96) && held.count(1000));
+    VERIFY(heap.min() == 2);
+
+    // recorded values versus values queried again
+    auto recorded = heap.getHeavyHitter(truth[94]);
+    VERIFY(recorded.size() == 2 && recorded[FlowKey<4>(95)] == truth[95]);
+    auto queried =
+        heap.getHeavyHitter(truth[94], [&](const FlowKey<4> &key) {
+          return key.getIp() == 95 ? 0 : truth[key.getIp()];
+        });
+    VERIFY(queried.size() == 1 && queried[FlowKey<4>(94)] == truth[94]);
+
+    heap.clear();
+    VERIFY(heap.empty());
+    VERIFY(heap.admits(0));
+  } catch (const std::exception &exp) {
+    VERIFY_NO_EXCEPTION(exp);
+  }
+}
+
+OMNISKETCH_DECLARE_TEST(topk) {
+  for (int i = 0; i < g_repeat; ++i) {
+    TestTopKHeap();
+  }
+}
+/** @endcond */